@@ -0,0 +1,501 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ai.h"
+#include "bitboard.h"
+
+bool ai_evaluate(const game_data *g, ai_move moves[4]) {
+    game_bitboards bb;
+    if (!bitboard_fromgame(&bb, g))
+        return false;
+
+    for (int d = UP; d <= LEFT; d++) {
+        ai_move *m = &moves[d];
+        m->safe = false;
+        m->food_dist = -1;
+        m->space = 0;
+
+        if ((d ^ g->dir) == 2)
+            continue;
+
+        vec2i next = vec2i_step(g->snake.head_pos, d, 1);
+        if (next.x < 0 || next.x >= g->cols || next.y < 0 || next.y >= g->rows) {
+            if (!bb.wrap)
+                continue;
+            next = game_wrap(g, next);
+        }
+
+        /* The tail moves out of its cell before the head moves in, it stays only when the snake grows. */
+        bool eats = bitboard_get(&bb.food, next);
+        bitboard open = bb.open;
+        if (!eats)
+            bitboard_set(&open, g->snake.tail_pos);
+
+        if (!bitboard_get(&open, next))
+            continue;
+
+        bitboard_unset(&open, next);
+        m->safe = true;
+
+        bitboard reach;
+        bitboard_clear(&reach, g->cols, g->rows);
+        bitboard_set(&reach, next);
+        m->food_dist = eats ? 0 : bitboard_distance(&reach, &bb.food, &open, bb.wrap);
+        m->space = bitboard_flood(&reach, &open, bb.wrap) - 1;
+    }
+
+    return true;
+}
+
+direction ai_greedy(const game_data *g, void *userdata) {
+    (void) userdata;
+
+    ai_move moves[4];
+    if (!ai_evaluate(g, moves))
+        return DIRECTION_NOVALUE;
+
+    /* The current direction first, so that ties keep it. */
+    direction best = DIRECTION_NOVALUE, roomiest = DIRECTION_NOVALUE;
+    for (int k = 0; k < 4; k++) {
+        direction d = (g->dir + k) & 3;
+        const ai_move *m = &moves[d];
+        if (!m->safe)
+            continue;
+
+        if (m->food_dist >= 0 && m->space >= g->snake.len &&
+            (best == DIRECTION_NOVALUE || m->food_dist < moves[best].food_dist))
+            best = d;
+        if (roomiest == DIRECTION_NOVALUE || m->space > moves[roomiest].space)
+            roomiest = d;
+    }
+
+    return best != DIRECTION_NOVALUE ? best : roomiest;
+}
+
+struct ai_pilot {
+    int ncells;
+    int *expire;     /* Ticks until a body cell is vacated, valid for SNAKE cells. */
+    int *dist;       /* Moves from the head, valid where seen is the current search. */
+    uint32_t *seen;
+    uint32_t search;
+    uint8_t *from;   /* The direction a cell was reached in. */
+    int *bucket[3];  /* Open cells of A* by f, see pilot_path(). */
+    int *queue;
+};
+
+ai_pilot *ai_pilot_create(void) {
+    return calloc(1, sizeof(ai_pilot));
+}
+
+void ai_pilot_destroy(ai_pilot *p) {
+    if (p == NULL)
+        return;
+
+    free(p->expire);
+    free(p->dist);
+    free(p->seen);
+    free(p->from);
+    for (int i = 0; i < 3; i++)
+        free(p->bucket[i]);
+    free(p->queue);
+    free(p);
+}
+
+static bool pilot_reserve(ai_pilot *p, int ncells) {
+    if (p->ncells == ncells)
+        return true;
+
+    /* Every expansion opens at most 4 cells, and each cell is expanded at most once. */
+    p->expire = realloc(p->expire, ncells * sizeof(int));
+    p->dist = realloc(p->dist, ncells * sizeof(int));
+    p->seen = realloc(p->seen, ncells * sizeof(uint32_t));
+    p->from = realloc(p->from, ncells);
+    p->queue = realloc(p->queue, ncells * sizeof(int));
+    bool ok = p->expire && p->dist && p->seen && p->from && p->queue;
+    for (int i = 0; i < 3; i++) {
+        p->bucket[i] = realloc(p->bucket[i], 4 * ncells * sizeof(int));
+        ok = ok && p->bucket[i];
+    }
+
+    if (!ok) {
+        p->ncells = 0;
+        return false;
+    }
+
+    memset(p->seen, 0, ncells * sizeof(uint32_t));
+    p->search = 0;
+    p->ncells = ncells;
+    return true;
+}
+
+/* Starts a search, all cells are unseen. */
+static uint32_t pilot_search(ai_pilot *p) {
+    if (++p->search == 0) {
+        memset(p->seen, 0, p->ncells * sizeof(uint32_t));
+        p->search = 1;
+    }
+    return p->search;
+}
+
+/* Moves v to the cell next to it, returns false past a wall. */
+static inline bool pilot_step(const game_data *g, vec2i *v, direction d, bool wrap) {
+    *v = vec2i_step(*v, d, 1);
+    if (v->x < 0 || v->x >= g->cols || v->y < 0 || v->y >= g->rows) {
+        if (!wrap)
+            return false;
+        *v = game_wrap(g, *v);
+    }
+    return true;
+}
+
+/* A cell the head can be in after the given number of moves. */
+static inline bool pilot_free(const ai_pilot *p, const game_data *g, int cell, int moves) {
+    return g->board[cell] != SNAKE || p->expire[cell] <= moves;
+}
+
+/* Manhattan distance to the food, around the edges on a torus. */
+static inline int pilot_heuristic(const game_data *g, vec2i v, bool wrap) {
+    int dx = abs(v.x - g->food.x), dy = abs(v.y - g->food.y);
+    if (wrap) {
+        if (dx > g->cols - dx) dx = g->cols - dx;
+        if (dy > g->rows - dy) dy = g->rows - dy;
+    }
+    return dx + dy;
+}
+
+/* The first move on the shortest way to the food, DIRECTION_NOVALUE if there is none.
+ * A move changes f = dist + heuristic by 0 or 2, or by 1 across the middle of an odd torus,
+ * so three FIFO buckets make the priority queue. */
+static direction pilot_path(ai_pilot *p, const game_data *g, bool wrap) {
+    const uint32_t s = pilot_search(p);
+    const int cols = g->cols;
+    const int head = g->snake.head_pos.y*cols + g->snake.head_pos.x;
+    const int food = g->food.y*cols + g->food.x;
+
+    p->seen[head] = s;
+    p->dist[head] = 0;
+    int f = pilot_heuristic(g, g->snake.head_pos, wrap);
+    int n[3] = { 0, 0, 0 };
+    p->bucket[f % 3][n[f % 3]++] = head;
+
+    for (; n[0] + n[1] + n[2] > 0; f++) {
+        const int cur = f % 3;
+        /* The current bucket grows while it is expanded. */
+        for (int k = 0; k < n[cur]; k++) {
+            const int cell = p->bucket[cur][k], d = p->dist[cell];
+            const vec2i pos = { cell % cols, cell / cols };
+            /* Left behind when a shorter way was found. */
+            if (d + pilot_heuristic(g, pos, wrap) != f)
+                continue;
+
+            if (cell == food) {
+                /* Walk back to the move out of the head. */
+                vec2i v = pos;
+                direction first = p->from[cell];
+                for (int i = d; i > 1; i--) {
+                    pilot_step(g, &v, (first + 2) & 3, wrap);
+                    first = p->from[v.y*cols + v.x];
+                }
+                return first;
+            }
+
+            for (int dir = UP; dir <= LEFT; dir++) {
+                /* The snake can not turn back. */
+                if (cell == head && (dir ^ g->dir) == 2)
+                    continue;
+
+                vec2i v = pos;
+                if (!pilot_step(g, &v, dir, wrap))
+                    continue;
+
+                int next = v.y*cols + v.x;
+                if ((p->seen[next] == s && p->dist[next] <= d + 1) || !pilot_free(p, g, next, d + 1))
+                    continue;
+
+                p->seen[next] = s;
+                p->dist[next] = d + 1;
+                p->from[next] = dir;
+                int b = (d + 1 + pilot_heuristic(g, v, wrap)) % 3;
+                p->bucket[b][n[b]++] = next;
+            }
+        }
+
+        n[cur] = 0;
+    }
+
+    return DIRECTION_NOVALUE;
+}
+
+/* The number of cells the head can get to from the one it moves into, counting up to limit. */
+static int pilot_space(ai_pilot *p, const game_data *g, vec2i start, int limit, bool wrap) {
+    const uint32_t s = pilot_search(p);
+    const int cols = g->cols;
+    const int first = start.y*cols + start.x;
+    p->seen[first] = s;
+    p->dist[first] = 1;
+    p->queue[0] = first;
+
+    int head = 0, tail = 1;
+    while (head < tail && tail < limit) {
+        const int cell = p->queue[head++], d = p->dist[cell];
+        const vec2i pos = { cell % cols, cell / cols };
+        for (int dir = UP; dir <= LEFT; dir++) {
+            vec2i v = pos;
+            if (!pilot_step(g, &v, dir, wrap))
+                continue;
+
+            int next = v.y*cols + v.x;
+            if (p->seen[next] == s || !pilot_free(p, g, next, d + 1))
+                continue;
+
+            p->seen[next] = s;
+            p->dist[next] = d + 1;
+            p->queue[tail++] = next;
+        }
+    }
+
+    return tail;
+}
+
+direction ai_autopilot(const game_data *g, void *userdata) {
+    ai_pilot *p = userdata;
+    if (g->state != RUNNING || !pilot_reserve(p, g->cols * g->rows))
+        return DIRECTION_NOVALUE;
+
+    const bool wrap = !levels[g->level].wall_collisions;
+
+    /* The tail is vacated on the next tick, the head after len ticks. */
+    for (game_iter it = game_iter_begin(g); it.i < g->snake.len; game_iter_next(g, &it))
+        p->expire[it.pos.y*g->cols + it.pos.x] = g->snake.len - it.i;
+
+    direction d = pilot_path(p, g, wrap);
+    if (d != DIRECTION_NOVALUE) {
+        vec2i next = g->snake.head_pos;
+        pilot_step(g, &next, d, wrap);
+        if (pilot_space(p, g, next, g->snake.len, wrap) >= g->snake.len)
+            return d;
+    }
+
+    /* The longest survival: the move with the most room. A move into the room
+     * another one has already been counted for gets the same count. */
+    direction best = DIRECTION_NOVALUE;
+    int best_space = 0, nsearched = 0;
+    uint32_t searched[3];
+    int spaces[3];
+    for (int k = 0; k < 4; k++) {
+        d = (g->dir + k) & 3;
+        vec2i next = g->snake.head_pos;
+        if ((d ^ g->dir) == 2 || !pilot_step(g, &next, d, wrap))
+            continue;
+
+        const int cell = next.y*g->cols + next.x;
+        if (!pilot_free(p, g, cell, 1))
+            continue;
+
+        int space = -1;
+        for (int j = 0; j < nsearched && space < 0; j++)
+            if (p->seen[cell] == searched[j])
+                space = spaces[j];
+
+        if (space < 0) {
+            space = pilot_space(p, g, next, g->cols * g->rows, wrap);
+            searched[nsearched] = p->search;
+            spaces[nsearched++] = space;
+        }
+
+        if (space > best_space) {
+            best = d;
+            best_space = space;
+        }
+    }
+
+    return best;
+}
+
+struct ai_cycle {
+    int cols, rows;
+    bool wrap;
+    int length;         /* Cells on the cycle. */
+    int spare, twin;    /* The cell left off the cycle and the one it can take the place of, -1 if there is none. */
+    int entry;          /* The cell before the twin, the only way into the spare. */
+    int *index;         /* Position of a cell on the cycle, the spare shares the one of its twin. */
+    uint8_t *next;      /* The direction to the next cell on the cycle. */
+};
+
+/* Sets the way out of a cell, in a layout that can be transposed. */
+static void cycle_set(ai_cycle *c, int x, int y, direction d, bool transpose) {
+    if (transpose)
+        c->next[x*c->cols + y] = 3 - d; /* UP and LEFT, RIGHT and DOWN swap. */
+    else c->next[y*c->cols + x] = d;
+}
+
+/* A w x h layout with an even h: along the first row, back and forth over the rest of the
+ * columns and up the first one. */
+static void cycle_layout(ai_cycle *c, int w, int h, bool transpose) {
+    for (int x = 0; x < w-1; x++)
+        cycle_set(c, x, 0, RIGHT, transpose);
+    cycle_set(c, w-1, 0, DOWN, transpose);
+
+    for (int y = 1; y < h; y++) {
+        cycle_set(c, 0, y, UP, transpose);
+        for (int x = 1; x < w; x++) {
+            if (y % 2)
+                cycle_set(c, x, y, x > 1 ? LEFT : y < h-1 ? DOWN : LEFT, transpose);
+            else cycle_set(c, x, y, x < w-1 ? RIGHT : DOWN, transpose);
+        }
+    }
+}
+
+/* An odd board with walls has no cycle over all of its cells. The bottom row is threaded into
+ * the one above it in pairs, which leaves out the corner; the corner can stand in for the cell
+ * diagonal to it, the way between their common neighbours is as long. */
+static void cycle_layout_spare(ai_cycle *c) {
+    const int w = c->cols, h = c->rows;
+    cycle_layout(c, w, h-1, false);
+    for (int x = 1; x < w-1; x += 2) {
+        cycle_set(c, x, h-2, DOWN, false);
+        cycle_set(c, x, h-1, LEFT, false);
+        cycle_set(c, x-1, h-1, UP, false);
+    }
+
+    c->spare = (h-1)*w + w-1;
+    c->twin = (h-2)*w + w-2;
+    c->entry = (h-2)*w + w-1;
+    c->next[c->spare] = LEFT;
+}
+
+/* An odd torus: along the first row, then down and up the columns from the last one to the
+ * first, which ends below the start. */
+static void cycle_layout_torus(ai_cycle *c) {
+    const int w = c->cols, h = c->rows;
+    for (int x = 0; x < w; x++) {
+        c->next[x] = x < w-1 ? RIGHT : DOWN;
+        bool down = (w-1 - x) % 2 == 0;
+        for (int y = 1; y < h; y++) {
+            if (down)
+                c->next[y*w + x] = y < h-1 || x == 0 ? DOWN : LEFT;
+            else c->next[y*w + x] = y > 1 ? UP : LEFT;
+        }
+    }
+}
+
+/* The cell next to another one, around the edges on a torus and -1 past a wall. */
+static int cycle_step(const ai_cycle *c, int cell, direction d) {
+    vec2i v = vec2i_step((vec2i) { cell % c->cols, cell / c->cols }, d, 1);
+    if (v.x < 0 || v.x >= c->cols || v.y < 0 || v.y >= c->rows) {
+        if (!c->wrap)
+            return -1;
+        v.x = (v.x + c->cols) % c->cols;
+        v.y = (v.y + c->rows) % c->rows;
+    }
+    return v.y*c->cols + v.x;
+}
+
+ai_cycle *ai_cycle_create(int cols, int rows, bool wrap) {
+    if (cols < GAME_MIN_SIZE || rows < GAME_MIN_SIZE)
+        return NULL;
+
+    ai_cycle *c = calloc(1, sizeof(ai_cycle));
+    if (c == NULL)
+        return NULL;
+
+    const int ncells = cols * rows;
+    c->cols = cols;
+    c->rows = rows;
+    c->wrap = wrap;
+    c->spare = c->twin = c->entry = -1;
+    c->index = malloc(ncells * sizeof(int));
+    c->next = malloc(ncells);
+    if (c->index == NULL || c->next == NULL) {
+        ai_cycle_destroy(c);
+        return NULL;
+    }
+
+    if (rows % 2 == 0)
+        cycle_layout(c, cols, rows, false);
+    else if (cols % 2 == 0)
+        cycle_layout(c, rows, cols, true);
+    else if (wrap)
+        cycle_layout_torus(c);
+    else cycle_layout_spare(c);
+
+    c->length = c->spare < 0 ? ncells : ncells - 1;
+    for (int i = 0, cell = 0; i < c->length; i++) {
+        c->index[cell] = i;
+        cell = cycle_step(c, cell, c->next[cell]);
+        assert(cell >= 0 && (cell == 0) == (i == c->length - 1));
+    }
+    if (c->spare >= 0)
+        c->index[c->spare] = c->index[c->twin];
+
+    return c;
+}
+
+void ai_cycle_destroy(ai_cycle *c) {
+    if (c == NULL)
+        return;
+
+    free(c->index);
+    free(c->next);
+    free(c);
+}
+
+/* Cells along the cycle from one cell to another. */
+static inline int cycle_ahead(const ai_cycle *c, int from, int to) {
+    int d = c->index[to] - c->index[from];
+    return d < 0 ? d + c->length : d;
+}
+
+direction ai_hamilton(const game_data *g, void *userdata) {
+    const ai_cycle *c = userdata;
+    if (g->state != RUNNING || g->cols != c->cols || g->rows != c->rows ||
+        (c->wrap && levels[g->level].wall_collisions))
+        return DIRECTION_NOVALUE;
+
+    const int cols = g->cols, ncells = g->cols * g->rows;
+    const int head = g->snake.head_pos.y*cols + g->snake.head_pos.x;
+    const int tail = g->snake.tail_pos.y*cols + g->snake.tail_pos.x;
+    const int food = g->food.y*cols + g->food.x;
+
+    direction best = c->next[head];
+
+    /* Into the spare or its twin, whichever has the food. With the tail in one of them the head
+     * takes its place, unless the other one is the last free cell. The spare is below. */
+    if (head == c->entry) {
+        bool spare = food == c->spare;
+        if (tail == c->spare || tail == c->twin)
+            spare = (tail == c->spare) != (g->snake.len == ncells - 1);
+
+        direction d = spare ? DOWN : best;
+        if ((d ^ g->dir) != 2)
+            return d;
+    }
+
+    /* The body lies in order along the cycle from the tail to the head. Any move that keeps it so
+     * is safe, the head can always go on along the cycle after it. Of those, take the one closest
+     * to the food along the cycle. The tail stays where it is only when the snake eats. */
+    vec2i tail_next = game_wrap(g, vec2i_step(g->snake.tail_pos, game_segment_dir(g, g->snake.len-2), 1));
+    const int moved = tail_next.y*cols + tail_next.x;
+    const int target = food == c->spare ? c->entry : food;
+    int best_dist = (best ^ g->dir) == 2 ? ncells : cycle_ahead(c, cycle_step(c, head, best), target);
+    for (int d = UP; d <= LEFT; d++) {
+        int cell = cycle_step(c, head, d);
+        if ((d ^ g->dir) == 2 || cell < 0 || cell == c->spare || g->board[cell] == SNAKE)
+            continue;
+
+        /* A cell is kept free in front of the tail: with the food in the spare or its twin and the
+         * tail in the other one, the head could otherwise catch up with the tail there every time. */
+        int end = cell == food ? tail : moved, ahead = cycle_ahead(c, end, cell);
+        if (ahead <= cycle_ahead(c, end, head) || ahead > c->length - 2)
+            continue;
+
+        int dist = cycle_ahead(c, cell, target);
+        if (dist < best_dist) {
+            best = d;
+            best_dist = dist;
+        }
+    }
+
+    return best;
+}
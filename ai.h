@@ -0,0 +1,50 @@
+#ifndef SNAKERL_AI_H
+#define SNAKERL_AI_H
+
+/* Bots playing the game. The policies fit game_policy in sim.h. ai_greedy keeps no state
+ * between the calls, ai_autopilot searches in the memory of an ai_pilot. */
+
+#include "game.h"
+
+/* What a move leads to on the next tick. */
+typedef struct {
+    bool safe;     /* The head runs into neither the body nor a wall. */
+    int food_dist; /* Moves from the new head to the food over free cells, -1 if there is no way. */
+    int space;     /* Free cells the new head can still get to. */
+} ai_move;
+
+/* Evaluates the moves of a RUNNING game, indexed by direction. Reversing is never safe.
+ * Returns false if the board is too large for a bitboard (see bitboard.h). */
+bool ai_evaluate(const game_data *g, ai_move moves[4]);
+
+/* Takes the shortest way to the food that leaves the snake enough room to fit in,
+ * otherwise the move with the most space. Keeps the direction on boards too large to evaluate. */
+direction ai_greedy(const game_data *g, void *userdata);
+
+/* Memory for the searches of ai_autopilot, sized for the last board seen. */
+typedef struct ai_pilot ai_pilot;
+
+ai_pilot *ai_pilot_create(void);
+void ai_pilot_destroy(ai_pilot *p);
+
+/* Follows the shortest way to the food over the occupancy grid (A*), on a torus when the level has
+ * no wall collisions. Body cells count as free once the tail has left them by the time the head gets
+ * there. If there is no way, or it leaves the snake too little room, takes the move with the most space.
+ * Works on boards of any size. The userdata is an ai_pilot, which only one thread can use at a time. */
+direction ai_autopilot(const game_data *g, void *userdata);
+
+/* A Hamiltonian cycle over a board. On an odd board with walls, where there is none, one corner
+ * is left off the cycle and taken in place of the cell diagonal to it. */
+typedef struct ai_cycle ai_cycle;
+
+/* Returns NULL if the board is smaller than GAME_MIN_SIZE either way, where no game starts, or out of memory. */
+ai_cycle *ai_cycle_create(int cols, int rows, bool wrap);
+void ai_cycle_destroy(ai_cycle *c);
+
+/* Follows the cycle and cuts ahead towards the food wherever the body stays in order along it,
+ * which fills the board every time. Has to steer from the start of the game. The userdata is an
+ * ai_cycle for the board, only read, so the threads of a sim_pool can share it. Keeps the direction
+ * on another board, or on one with walls if the cycle wraps around the edges. */
+direction ai_hamilton(const game_data *g, void *userdata);
+
+#endif
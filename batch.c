@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+
+static inline int batch_ncells(const game_batch *b) {
+    return b->cols * b->rows;
+}
+
+/* Changes the type of a cell of game i, keeping the count of vacant cells in its row. */
+static inline void batch_setcell(game_batch *b, int i, int32_t x, int32_t y, cell_type type) {
+    uint8_t *cell = b->board + (size_t) i * batch_ncells(b) + y * b->cols + x;
+    b->vacant[(size_t) i * b->rows + y] += (*cell != EMPTY) - (type != EMPTY);
+    *cell = type;
+}
+
+static void batch_food(game_batch *b, int i) {
+    const int ncells = batch_ncells(b);
+    uint8_t *board = b->board + (size_t) i * ncells;
+
+    /* The old food has just become a part of the snake. */
+    int nvacant = ncells - b->len[i];
+    if (nvacant == 0) {
+        b->state[i] = WON;
+        return;
+    }
+
+    /* Sampling a random cell is fast while the board is sparse. Once it keeps hitting the snake,
+     * pick the k-th vacant cell instead, so that it always terminates. The row counts find its row,
+     * only that row is scanned. A vacant set like the one of game_data would make it O(1), but it takes
+     * 8 bytes per cell where the board takes one, too much for a batch of many games. */
+    int cell = -1;
+    for (int tries = 0; tries < 8 && cell < 0; tries++) {
+        int c = rng_below(&b->rng[i], ncells);
+        if (board[c] == EMPTY)
+            cell = c;
+    }
+
+    if (cell < 0) {
+        int k = rng_below(&b->rng[i], nvacant);
+        const int32_t *vacant = b->vacant + (size_t) i * b->rows;
+        int y = 0;
+        for (; k >= vacant[y]; y++)
+            k -= vacant[y];
+        for (cell = y * b->cols; board[cell] != EMPTY || k-- > 0; cell++);
+    }
+
+    b->food_x[i] = cell % b->cols;
+    b->food_y[i] = cell / b->cols;
+    batch_setcell(b, i, b->food_x[i], b->food_y[i], FOOD);
+}
+
+static inline void batch_push(game_batch *b, int i, int32_t x, int32_t y, direction dir) {
+    int32_t ring = b->ring[i] + 1;
+    if (ring == batch_ncells(b))
+        ring = 0;
+
+    b->ring[i] = ring;
+    dirs_set(b->body + (size_t) i * b->body_stride, ring, dir);
+    batch_setcell(b, i, x, y, SNAKE);
+    b->len[i]++;
+}
+
+void batch_reset(game_batch *b, int i) {
+    const int ncells = batch_ncells(b);
+    memset(b->board + (size_t) i * ncells, EMPTY, ncells);
+    for (int y = 0; y < b->rows; y++)
+        b->vacant[(size_t) i * b->rows + y] = b->cols;
+
+    /* Same initial position as game_reset(): the tail is generated first,
+     * in opposite direction of the initial movement. */
+    int32_t dir = rng_below(&b->rng[i], 4);
+    int32_t x = rng_below(&b->rng[i], b->cols/2) + b->cols/4;
+    int32_t y = rng_below(&b->rng[i], b->rows/2) + b->rows/4;
+    int32_t dx = (dir == RIGHT) - (dir == LEFT);
+    int32_t dy = (dir == DOWN) - (dir == UP);
+
+    b->len[i] = 0;
+    b->ring[i] = 0;
+    batch_push(b, i, x - dx, y - dy, dir);
+    batch_push(b, i, x, y, dir);
+
+    b->dir[i] = dir;
+    b->head_x[i] = x;
+    b->head_y[i] = y;
+    b->tail_x[i] = x - dx;
+    b->tail_y[i] = y - dy;
+    b->hit[i] = 0;
+    b->state[i] = RUNNING;
+    batch_food(b, i);
+}
+
+void batch_destroy(game_batch *b) {
+    if (b == NULL)
+        return;
+
+    free(b->head_x);
+    free(b->head_y);
+    free(b->tail_x);
+    free(b->tail_y);
+    free(b->dir);
+    free(b->len);
+    free(b->food_x);
+    free(b->food_y);
+    free(b->state);
+    free(b->hit);
+    free(b->rng);
+    free(b->ring);
+    free(b->body);
+    free(b->board);
+    free(b->vacant);
+    free(b);
+}
+
+game_batch *batch_create(int n, int cols, int rows, int level, uint64_t seed) {
+    if (n <= 0 || cols < GAME_MIN_SIZE || rows < GAME_MIN_SIZE)
+        return NULL;
+
+    game_batch *b = calloc(1, sizeof(game_batch));
+    if (b == NULL)
+        return NULL;
+
+    b->n = n;
+    b->cols = cols;
+    b->rows = rows;
+    b->level = level;
+    b->move = batch_getkernel(BATCH_KERNEL_AUTO);
+
+    size_t ncells = (size_t) n * cols * rows;
+    b->head_x = malloc(n * sizeof(int32_t));
+    b->head_y = malloc(n * sizeof(int32_t));
+    b->tail_x = malloc(n * sizeof(int32_t));
+    b->tail_y = malloc(n * sizeof(int32_t));
+    b->dir = malloc(n * sizeof(int32_t));
+    b->len = malloc(n * sizeof(int32_t));
+    b->food_x = malloc(n * sizeof(int32_t));
+    b->food_y = malloc(n * sizeof(int32_t));
+    b->state = malloc(n);
+    b->hit = malloc(n);
+    b->rng = malloc(n * sizeof(rng_state));
+    b->ring = malloc(n * sizeof(int32_t));
+    b->body_stride = (cols * rows + 3) / 4;
+    b->body = malloc((size_t) n * b->body_stride);
+    b->board = malloc(ncells);
+    b->vacant = malloc((size_t) n * rows * sizeof(int32_t));
+
+    if (!b->head_x || !b->head_y || !b->tail_x || !b->tail_y || !b->dir || !b->len || !b->food_x || !b->food_y ||
+        !b->state || !b->hit || !b->rng || !b->ring || !b->body || !b->board || !b->vacant) {
+        batch_destroy(b);
+        return NULL;
+    }
+
+    for (int i = 0; i < n; i++) {
+        rng_init(&b->rng[i], rng_seed(seed, i));
+        batch_reset(b, i);
+    }
+
+    return b;
+}
+
+int batch_step(game_batch *b, const int32_t *actions) {
+    const int n = b->n;
+    const int ncells = batch_ncells(b);
+
+    /* Same rule as game_setdirection(): only turns across the axis of movement are allowed.
+     * UP/DOWN are even and LEFT/RIGHT are odd. */
+    if (actions != NULL) {
+        const int32_t *restrict act = actions;
+        int32_t *restrict dir = b->dir;
+        for (int i = 0; i < n; i++) {
+            int32_t a = act[i];
+            int32_t turn = -(int32_t) ((a >= 0) & ((a ^ dir[i]) & 1));
+            dir[i] = (a & turn) | (dir[i] & ~turn);
+        }
+    }
+
+    b->move(b->n, b->cols, b->rows, !levels[b->level].wall_collisions,
+            b->head_x, b->head_y, b->dir, b->state, b->hit);
+
+    /* Body and food updates touch each game's own grid, these stay scalar. */
+    int running = 0;
+    for (int i = 0; i < n; i++) {
+        if (b->state[i] != RUNNING)
+            continue;
+
+        if (b->hit[i]) {
+            b->state[i] = LOST;
+            continue;
+        }
+
+        const uint8_t *board = b->board + (size_t) i * ncells;
+        const uint8_t *body = b->body + (size_t) i * b->body_stride;
+        int head = b->head_y[i] * b->cols + b->head_x[i];
+
+        /* The segment in front of the tail was entered in the direction the tail moves to. */
+        int32_t next_idx = b->ring[i] - (b->len[i] - 2);
+        if (next_idx < 0)
+            next_idx += ncells;
+        direction tail_dir = dirs_get(body, next_idx);
+
+        /* The tail moves out of its cell, so the head may enter it. */
+        batch_setcell(b, i, b->tail_x[i], b->tail_y[i], EMPTY);
+
+        uint8_t head_cell = board[head];
+        if (head_cell == SNAKE) {
+            b->state[i] = LOST;
+            continue;
+        }
+
+        if (head_cell == FOOD) {
+            /* Growing: the tail stays where it was. */
+            batch_setcell(b, i, b->tail_x[i], b->tail_y[i], SNAKE);
+            batch_push(b, i, b->head_x[i], b->head_y[i], b->dir[i]);
+            batch_food(b, i);
+        } else {
+            batch_push(b, i, b->head_x[i], b->head_y[i], b->dir[i]);
+            b->len[i]--;
+
+            int32_t tx = b->tail_x[i] + (tail_dir == RIGHT) - (tail_dir == LEFT);
+            int32_t ty = b->tail_y[i] + (tail_dir == DOWN) - (tail_dir == UP);
+            b->tail_x[i] = tx < 0 ? tx + b->cols : tx >= b->cols ? tx - b->cols : tx;
+            b->tail_y[i] = ty < 0 ? ty + b->rows : ty >= b->rows ? ty - b->rows : ty;
+        }
+
+        running += b->state[i] == RUNNING;
+    }
+
+    return running;
+}
@@ -0,0 +1,61 @@
+#ifndef SNAKERL_BATCH_H
+#define SNAKERL_BATCH_H
+
+/* Many games with the same board size and level stepped in lockstep,
+ * following the same rules as game_step(). The state is kept as a structure of arrays
+ * indexed by the game number, so the per-tick head movement is a branch-free loop over all games. */
+
+#include "game.h"
+
+/* Moves the heads of the running games in [0, n) one cell in their direction.
+ * With wrap the heads make a transition to the opposite wall, otherwise hit is set for the games
+ * whose head left the board. */
+typedef void (*batch_move_fn)(int n, int32_t cols, int32_t rows, bool wrap,
+                              int32_t *x, int32_t *y, const int32_t *dir, const uint8_t *state, uint8_t *hit);
+
+typedef enum {
+    BATCH_KERNEL_AUTO, BATCH_KERNEL_SCALAR, BATCH_KERNEL_SSE2, BATCH_KERNEL_AVX2
+} batch_kernel;
+
+typedef struct {
+    int n;
+    int cols, rows;
+    int level;
+
+    /* Per-game state. */
+    int32_t *head_x, *head_y;
+    int32_t *tail_x, *tail_y;
+    int32_t *dir;
+    int32_t *len;
+    int32_t *food_x, *food_y;
+    uint8_t *state;   /* RUNNING, LOST or WON. */
+    uint8_t *hit;     /* Set when the head left the board during the last tick. */
+    rng_state *rng;   /* Game i starts from rng_seed(seed, i). */
+
+    /* Per-game bodies and occupancy grids, cols*rows entries for each game. */
+    int32_t *ring;    /* Index of the head segment in the body ring. */
+    uint8_t *body;    /* Rings of the directions each segment was entered in, packed as in dirs_get().
+                       * The tail is len-1 entries behind the head, each game takes body_stride bytes. */
+    int body_stride;
+    uint8_t *board;   /* See cell_type. */
+    int32_t *vacant;  /* EMPTY cells in each row of the board, rows entries for each game. */
+
+    batch_move_fn move;
+} game_batch;
+
+/* Returns NULL if the batch can not be allocated or the board is smaller than GAME_MIN_SIZE. */
+game_batch *batch_create(int n, int cols, int rows, int level, uint64_t seed);
+void batch_destroy(game_batch *b);
+
+/* Returns the head movement kernel, or NULL if the CPU does not support it.
+ * BATCH_KERNEL_AUTO picks the fastest supported one, see batch_simd.c. */
+batch_move_fn batch_getkernel(batch_kernel kernel);
+
+/* Starts a new game at index i. */
+void batch_reset(game_batch *b, int i);
+
+/* Turns every game towards its action (DIRECTION_NOVALUE keeps the direction, actions may be NULL)
+ * and advances all RUNNING games by one tick. Returns the number of games still running. */
+int batch_step(game_batch *b, const int32_t *actions);
+
+#endif
@@ -0,0 +1,178 @@
+/* Head movement kernels of the batched engine. All of them compute the same thing:
+ * the heads of the running games move one cell in their direction, then either wrap around
+ * to the opposite wall or flag the games whose head left the board.
+ * The SIMD versions are compiled with target attributes and selected at runtime. */
+
+#include <string.h>
+
+#include "batch.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BATCH_X86
+#include <immintrin.h>
+#endif
+
+/* Directions are UP, RIGHT, DOWN, LEFT, so the displacement is computed
+ * from comparisons instead of a lookup or a switch. */
+static void batch_move_scalar(int from, int to, int32_t cols, int32_t rows, bool wrap,
+                              int32_t *restrict x, int32_t *restrict y, const int32_t *restrict dir,
+                              const uint8_t *restrict state, uint8_t *restrict hit) {
+    if (!wrap) {
+        for (int i = from; i < to; i++) {
+            int32_t live = -(int32_t) (state[i] == RUNNING);
+            int32_t nx = x[i] + (((dir[i] == RIGHT) - (dir[i] == LEFT)) & live);
+            int32_t ny = y[i] + (((dir[i] == DOWN) - (dir[i] == UP)) & live);
+            hit[i] = (nx < 0) | (nx >= cols) | (ny < 0) | (ny >= rows);
+            x[i] = nx;
+            y[i] = ny;
+        }
+    } else {
+        for (int i = from; i < to; i++) {
+            int32_t live = -(int32_t) (state[i] == RUNNING);
+            int32_t nx = x[i] + (((dir[i] == RIGHT) - (dir[i] == LEFT)) & live);
+            int32_t ny = y[i] + (((dir[i] == DOWN) - (dir[i] == UP)) & live);
+            nx += cols & -(int32_t) (nx < 0);
+            nx -= cols & -(int32_t) (nx >= cols);
+            ny += rows & -(int32_t) (ny < 0);
+            ny -= rows & -(int32_t) (ny >= rows);
+            hit[i] = 0;
+            x[i] = nx;
+            y[i] = ny;
+        }
+    }
+}
+
+static void batch_move_plain(int n, int32_t cols, int32_t rows, bool wrap,
+                             int32_t *x, int32_t *y, const int32_t *dir, const uint8_t *state, uint8_t *hit) {
+    batch_move_scalar(0, n, cols, rows, wrap, x, y, dir, state, hit);
+}
+
+#ifdef BATCH_X86
+
+__attribute__((target("sse2")))
+static void batch_move_sse2(int n, int32_t cols, int32_t rows, bool wrap,
+                            int32_t *x, int32_t *y, const int32_t *dir, const uint8_t *state, uint8_t *hit) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vcols = _mm_set1_epi32(cols), vrows = _mm_set1_epi32(rows);
+    const __m128i maxx = _mm_set1_epi32(cols - 1), maxy = _mm_set1_epi32(rows - 1);
+    const __m128i up = _mm_set1_epi32(UP), right = _mm_set1_epi32(RIGHT);
+    const __m128i down = _mm_set1_epi32(DOWN), left = _mm_set1_epi32(LEFT);
+    const __m128i running = _mm_set1_epi32(RUNNING), one = _mm_set1_epi32(1);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t s;
+        memcpy(&s, state + i, 4);
+        __m128i st = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(s), zero), zero);
+        __m128i live = _mm_cmpeq_epi32(st, running);
+
+        /* Comparisons yield -1 for true, so (d == RIGHT) - (d == LEFT) turns around. */
+        __m128i d = _mm_loadu_si128((const __m128i *) (dir + i));
+        __m128i dx = _mm_and_si128(_mm_sub_epi32(_mm_cmpeq_epi32(d, left), _mm_cmpeq_epi32(d, right)), live);
+        __m128i dy = _mm_and_si128(_mm_sub_epi32(_mm_cmpeq_epi32(d, up), _mm_cmpeq_epi32(d, down)), live);
+        __m128i nx = _mm_add_epi32(_mm_loadu_si128((const __m128i *) (x + i)), dx);
+        __m128i ny = _mm_add_epi32(_mm_loadu_si128((const __m128i *) (y + i)), dy);
+
+        __m128i below_x = _mm_cmpgt_epi32(zero, nx), above_x = _mm_cmpgt_epi32(nx, maxx);
+        __m128i below_y = _mm_cmpgt_epi32(zero, ny), above_y = _mm_cmpgt_epi32(ny, maxy);
+        __m128i h;
+        if (wrap) {
+            nx = _mm_add_epi32(nx, _mm_and_si128(below_x, vcols));
+            nx = _mm_sub_epi32(nx, _mm_and_si128(above_x, vcols));
+            ny = _mm_add_epi32(ny, _mm_and_si128(below_y, vrows));
+            ny = _mm_sub_epi32(ny, _mm_and_si128(above_y, vrows));
+            h = zero;
+        } else {
+            h = _mm_or_si128(_mm_or_si128(below_x, above_x), _mm_or_si128(below_y, above_y));
+            h = _mm_and_si128(h, one);
+        }
+
+        _mm_storeu_si128((__m128i *) (x + i), nx);
+        _mm_storeu_si128((__m128i *) (y + i), ny);
+
+        h = _mm_packs_epi32(h, h);
+        s = _mm_cvtsi128_si32(_mm_packus_epi16(h, h));
+        memcpy(hit + i, &s, 4);
+    }
+
+    batch_move_scalar(i, n, cols, rows, wrap, x, y, dir, state, hit);
+}
+
+__attribute__((target("avx2")))
+static void batch_move_avx2(int n, int32_t cols, int32_t rows, bool wrap,
+                            int32_t *x, int32_t *y, const int32_t *dir, const uint8_t *state, uint8_t *hit) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i vcols = _mm256_set1_epi32(cols), vrows = _mm256_set1_epi32(rows);
+    const __m256i maxx = _mm256_set1_epi32(cols - 1), maxy = _mm256_set1_epi32(rows - 1);
+    const __m256i up = _mm256_set1_epi32(UP), right = _mm256_set1_epi32(RIGHT);
+    const __m256i down = _mm256_set1_epi32(DOWN), left = _mm256_set1_epi32(LEFT);
+    const __m256i running = _mm256_set1_epi32(RUNNING), one = _mm256_set1_epi32(1);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i st = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (state + i)));
+        __m256i live = _mm256_cmpeq_epi32(st, running);
+
+        __m256i d = _mm256_loadu_si256((const __m256i *) (dir + i));
+        __m256i dx = _mm256_and_si256(_mm256_sub_epi32(_mm256_cmpeq_epi32(d, left), _mm256_cmpeq_epi32(d, right)), live);
+        __m256i dy = _mm256_and_si256(_mm256_sub_epi32(_mm256_cmpeq_epi32(d, up), _mm256_cmpeq_epi32(d, down)), live);
+        __m256i nx = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *) (x + i)), dx);
+        __m256i ny = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *) (y + i)), dy);
+
+        __m256i below_x = _mm256_cmpgt_epi32(zero, nx), above_x = _mm256_cmpgt_epi32(nx, maxx);
+        __m256i below_y = _mm256_cmpgt_epi32(zero, ny), above_y = _mm256_cmpgt_epi32(ny, maxy);
+        __m256i h;
+        if (wrap) {
+            nx = _mm256_add_epi32(nx, _mm256_and_si256(below_x, vcols));
+            nx = _mm256_sub_epi32(nx, _mm256_and_si256(above_x, vcols));
+            ny = _mm256_add_epi32(ny, _mm256_and_si256(below_y, vrows));
+            ny = _mm256_sub_epi32(ny, _mm256_and_si256(above_y, vrows));
+            h = zero;
+        } else {
+            h = _mm256_or_si256(_mm256_or_si256(below_x, above_x), _mm256_or_si256(below_y, above_y));
+            h = _mm256_and_si256(h, one);
+        }
+
+        _mm256_storeu_si256((__m256i *) (x + i), nx);
+        _mm256_storeu_si256((__m256i *) (y + i), ny);
+
+        /* Narrow the eight 32-bit flags down to bytes. */
+        __m128i h16 = _mm_packs_epi32(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+        _mm_storel_epi64((__m128i *) (hit + i), _mm_packus_epi16(h16, h16));
+    }
+
+    batch_move_scalar(i, n, cols, rows, wrap, x, y, dir, state, hit);
+}
+
+#endif
+
+batch_move_fn batch_getkernel(batch_kernel kernel) {
+#ifdef BATCH_X86
+    __builtin_cpu_init();
+    bool has_avx2 = __builtin_cpu_supports("avx2");
+    bool has_sse2 = __builtin_cpu_supports("sse2");
+#else
+    bool has_avx2 = false, has_sse2 = false;
+#endif
+
+    switch (kernel) {
+    case BATCH_KERNEL_AUTO:
+#ifdef BATCH_X86
+        if (has_avx2) return batch_move_avx2;
+        if (has_sse2) return batch_move_sse2;
+#endif
+        return batch_move_plain;
+    case BATCH_KERNEL_SCALAR:
+        return batch_move_plain;
+#ifdef BATCH_X86
+    case BATCH_KERNEL_SSE2:
+        return has_sse2 ? batch_move_sse2 : NULL;
+    case BATCH_KERNEL_AVX2:
+        return has_avx2 ? batch_move_avx2 : NULL;
+#endif
+    default:
+        (void) has_avx2;
+        (void) has_sse2;
+        return NULL;
+    }
+}
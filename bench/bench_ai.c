@@ -0,0 +1,67 @@
+/* Decisions per second of the bots over whole games they play, and the slowest decision,
+ * which has to fit in a tick of 1 ms for the autopilot to keep up on a 200x100 board. */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "ai.h"
+#include "sim.h"
+
+#define BENCH_SECONDS 2.0
+
+static const struct { int cols, rows; } sizes[] = {
+    { 50, 25 }, { 200, 100 },
+};
+
+static void bench(const char *name, game_policy policy, void *userdata, int cols, int rows, int level) {
+    game_data g = {0};
+    game_init(&g, cols, rows, level, 1);
+
+    long decisions = 0, games = 0, won = 0;
+    int longest = 0;
+    clock_t total = 0, slowest = 0;
+    do {
+        clock_t start = clock();
+        direction d = policy(&g, userdata);
+        clock_t spent = clock() - start;
+
+        total += spent;
+        if (spent > slowest)
+            slowest = spent;
+        decisions++;
+
+        if (game_step(&g, d) != RUNNING) {
+            games++;
+            won += g.state == WON;
+            if (g.snake.len > longest)
+                longest = g.snake.len;
+            game_reset(&g);
+        }
+    } while ((double) total / CLOCKS_PER_SEC < BENCH_SECONDS);
+
+    if (g.snake.len > longest)
+        longest = g.snake.len;
+
+    printf("%-9s %3dx%-3d %-11s %10.3e decisions/s  slowest %7.3f ms  games %4ld won %4ld longest %5d\n",
+           name, cols, rows, levels[level].desc, decisions / ((double) total / CLOCKS_PER_SEC),
+           (double) slowest * 1000 / CLOCKS_PER_SEC, games, won, longest);
+
+    game_free(&g);
+}
+
+int main(void) {
+    ai_pilot *pilot = ai_pilot_create();
+    if (pilot == NULL)
+        return 1;
+
+    for (size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++)
+        for (int level = 0; level < 2; level++)
+            bench("autopilot", ai_autopilot, pilot, sizes[s].cols, sizes[s].rows, level);
+
+    /* Bitboards only take boards of up to 64 columns. */
+    for (int level = 0; level < 2; level++)
+        bench("greedy", ai_greedy, NULL, 50, 25, level);
+
+    ai_pilot_destroy(pilot);
+    return 0;
+}
@@ -0,0 +1,102 @@
+/* Ticks per second of the batched head movement kernels, scalar against SIMD,
+ * and of the complete batch_step() for reference. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "batch.h"
+
+#define BENCH_SECONDS 0.5
+
+static const int sizes[] = { 1000, 64*1024, 1024*1024 };
+static const char *kernel_names[] = { "auto", "scalar", "sse2", "avx2" };
+
+static double seconds(clock_t from) {
+    return (double) (clock() - from) / CLOCKS_PER_SEC;
+}
+
+static void bench_kernel(batch_kernel kernel, int n, bool wrap, double *base) {
+    batch_move_fn move = batch_getkernel(kernel);
+    if (move == NULL) {
+        printf("%-8s %8d %-5s   unsupported\n", kernel_names[kernel], n, wrap ? "wrap" : "walls");
+        return;
+    }
+
+    const int cols = 50, rows = 25;
+    int32_t *x = malloc(n * sizeof(int32_t)), *y = malloc(n * sizeof(int32_t));
+    int32_t *dir = malloc(n * sizeof(int32_t));
+    uint8_t *state = malloc(n), *hit = malloc(n);
+
+    srand(1);
+    for (int i = 0; i < n; i++) {
+        x[i] = rand() % cols;
+        y[i] = rand() % rows;
+        dir[i] = rand() % 4;
+        state[i] = RUNNING;
+    }
+
+    long ticks = 0;
+    clock_t start = clock();
+    do {
+        for (int t = 0; t < 16; t++)
+            move(n, cols, rows, wrap, x, y, dir, state, hit);
+        ticks += 16;
+    } while (seconds(start) < BENCH_SECONDS);
+
+    double rate = (double) ticks * n / seconds(start);
+    if (kernel == BATCH_KERNEL_SCALAR)
+        *base = rate;
+    printf("%-8s %8d %-5s %12.3e game ticks/s  x%.2f\n",
+           kernel_names[kernel], n, wrap ? "wrap" : "walls", rate, rate / *base);
+
+    free(x);
+    free(y);
+    free(dir);
+    free(state);
+    free(hit);
+}
+
+static void bench_step(int n, int level) {
+    game_batch *b = batch_create(n, 16, 16, level, 1);
+    if (b == NULL) {
+        printf("step     %8d unable to allocate\n", n);
+        return;
+    }
+
+    int32_t *actions = malloc(n * sizeof(int32_t));
+    long ticks = 0;
+    clock_t start = clock();
+    do {
+        /* Random turns, games that end are restarted so the population stays constant. */
+        for (int i = 0; i < n; i++)
+            actions[i] = rand() % 8 < 4 ? rand() % 4 : DIRECTION_NOVALUE;
+        batch_step(b, actions);
+        for (int i = 0; i < n; i++)
+            if (b->state[i] != RUNNING)
+                batch_reset(b, i);
+        ticks++;
+    } while (seconds(start) < BENCH_SECONDS);
+
+    printf("step     %8d %-11s %12.3e game ticks/s\n", n, levels[level].desc, (double) ticks * n / seconds(start));
+
+    free(actions);
+    batch_destroy(b);
+}
+
+int main(void) {
+    for (int wrap = 0; wrap < 2; wrap++) {
+        for (size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++) {
+            double base = 1;
+            for (int k = BATCH_KERNEL_SCALAR; k <= BATCH_KERNEL_AVX2; k++)
+                bench_kernel(k, sizes[s], wrap, &base);
+        }
+    }
+
+    for (int level = 0; level < 2; level++) {
+        bench_step(1000, level);
+        bench_step(64*1024, level);
+    }
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+/* Frame time of the CRT effect at 1080p and 4K: the original per-pixel SDL_GetRGBA/SDL_MapRGBA
+ * version against the table and SIMD kernels of fx.c. */
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+
+#include "fx.h"
+
+#define BENCH_FRAMES 20
+
+static const struct { const char *name; int w, h; } sizes[] = {
+    { "1080p", 1920, 1080 },
+    { "4K", 3840, 2160 },
+};
+
+static const char *kernel_names[] = { "auto", "scalar", "sse2", "avx2", "neon" };
+
+static const double intensity = 0.15;
+
+/* The effect as it was before fx.c. */
+static void crt_reference(SDL_Surface *screen) {
+    double crtk = 1 - intensity;
+
+    SDL_LockSurface(screen);
+
+    for (int y = 0; y < screen->h; y++) {
+        Uint32 *pixels = (Uint32 *) ((Uint8 *) screen->pixels + y*screen->pitch);
+        for (int x = 0; x < screen->w; x++) {
+            SDL_Color pixel;
+            SDL_GetRGBA(pixels[x], screen->format, &pixel.r, &pixel.g, &pixel.b, &pixel.a);
+
+            SDL_Color out = pixel;
+
+            switch (y % 3) {
+            case 0: out.r = crtk*pixel.r; out.g = crtk*pixel.g; break;
+            case 1: out.r = crtk*pixel.r; out.b = crtk*pixel.b; break;
+            case 2: out.g = crtk*pixel.g; out.b = crtk*pixel.b; break;
+            }
+
+            pixels[x] = SDL_MapRGBA(screen->format, out.r, out.g, out.b, out.a);
+        }
+    }
+
+    SDL_UnlockSurface(screen);
+}
+
+static double now_ms(void) {
+    return SDL_GetPerformanceCounter() * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    for (size_t s = 0; s < SDL_arraysize(sizes); s++) {
+        SDL_Surface *surf = SDL_CreateRGBSurfaceWithFormat(0, sizes[s].w, sizes[s].h, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (surf == NULL) {
+            SDL_Log("Unable to create surface: %s", SDL_GetError());
+            return 1;
+        }
+        SDL_FillRect(surf, NULL, SDL_MapRGB(surf->format, 200, 180, 160));
+
+        double start = now_ms();
+        for (int i = 0; i < BENCH_FRAMES; i++)
+            crt_reference(surf);
+        double reference = (now_ms() - start) / BENCH_FRAMES;
+        printf("%-6s %-9s %8.3f ms/frame\n", sizes[s].name, "reference", reference);
+
+        fx_crt crt;
+        fx_crt_init(&crt, intensity, surf->format->Rmask, surf->format->Gmask, surf->format->Bmask);
+        for (int k = FX_KERNEL_SCALAR; k <= FX_KERNEL_NEON; k++) {
+            if (!fx_crt_setkernel(&crt, k))
+                continue;
+
+            start = now_ms();
+            for (int i = 0; i < BENCH_FRAMES; i++)
+                fx_crt_apply(&crt, surf->pixels, surf->pitch, 0, 0, surf->w, surf->h);
+            double t = (now_ms() - start) / BENCH_FRAMES;
+            printf("%-6s %-9s %8.3f ms/frame  x%.1f\n", sizes[s].name, kernel_names[k], t, reference / t);
+        }
+
+        SDL_FreeSurface(surf);
+    }
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+/* Glyphs per second drawn into a 32-bit surface: SDL_BlitSurface from an INDEX8 font bitmap
+ * (the way ui_putch drew them), a same-format blit from a cache of colored glyphs,
+ * and the 1-bit expansion kernels of glyph.c, for glyphs 8, 11 and 16 pixels wide. */
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+
+#include "glyph.h"
+
+#define BENCH_GLYPHS 2000000
+
+static const struct { int w, h; } sizes[] = {
+    { 8, 16 }, { 11, 11 }, { 16, 16 },
+};
+
+static const char *kernel_names[] = { "auto", "scalar", "sse2", "avx2", "neon" };
+
+static double now_s(void) {
+    return (double) SDL_GetPerformanceCounter() / SDL_GetPerformanceFrequency();
+}
+
+/* State of the method being measured. */
+static SDL_Surface *screen, *bitmap, *atlas;
+static glyph_font font;
+static int glyph_w, glyph_h;
+static Uint32 fg, bg;
+
+static const SDL_Color colors[2][2] = {
+    { { 255, 255, 255, SDL_ALPHA_OPAQUE }, { 0, 0, 0, SDL_ALPHA_OPAQUE } },
+    { { 255, 255, 255, SDL_ALPHA_OPAQUE }, { 255, 0, 0, SDL_ALPHA_OPAQUE } },
+};
+
+static void draw_index8(int n, unsigned char c, int x, int y) {
+    (void) n;
+    SDL_Rect src = { c % 16 * glyph_w, c / 16 * glyph_h, glyph_w, glyph_h }, dst = { x, y, glyph_w, glyph_h };
+    SDL_BlitSurface(bitmap, &src, screen, &dst);
+}
+
+/* Changing the colors between glyphs, as draw() did for the messages. */
+static void draw_index8_recolor(int n, unsigned char c, int x, int y) {
+    SDL_SetPaletteColors(bitmap->format->palette, colors[n & 1], 0, 2);
+    draw_index8(n, c, x, y);
+}
+
+static void draw_cached(int n, unsigned char c, int x, int y) {
+    (void) n;
+    SDL_Rect src = { c % 16 * glyph_w, c / 16 * glyph_h, glyph_w, glyph_h }, dst = { x, y, glyph_w, glyph_h };
+    SDL_BlitSurface(atlas, &src, screen, &dst);
+}
+
+static void draw_expand(int n, unsigned char c, int x, int y) {
+    (void) n;
+    glyph_draw(&font, c, fg, bg, (Uint8 *) screen->pixels + y * screen->pitch + x * 4, screen->pitch);
+}
+
+/* Draws BENCH_GLYPHS glyphs row by row over the screen, returns glyphs per second. */
+static double bench(void (*draw)(int n, unsigned char c, int x, int y)) {
+    const int cols = screen->w / glyph_w, rows = screen->h / glyph_h;
+
+    double start = now_s();
+    for (int n = 0; n < BENCH_GLYPHS; n++) {
+        const int i = n % (cols * rows);
+        draw(n, 32 + n % 96, i % cols * glyph_w, i / cols * glyph_h);
+    }
+    return BENCH_GLYPHS / (now_s() - start);
+}
+
+int main(int argc, char *argv[]) {
+    (void) argc;
+    (void) argv;
+
+    screen = SDL_CreateRGBSurfaceWithFormat(0, 1920, 1080, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (screen == NULL) {
+        SDL_Log("Unable to create surface: %s", SDL_GetError());
+        return 1;
+    }
+
+    for (size_t s = 0; s < SDL_arraysize(sizes); s++) {
+        const int w = glyph_w = sizes[s].w, h = glyph_h = sizes[s].h;
+
+        /* A font with a pseudo-random pattern in each glyph, in both representations. */
+        bitmap = SDL_CreateRGBSurfaceWithFormat(0, 16*w, 16*h, 8, SDL_PIXELFORMAT_INDEX8);
+        if (bitmap == NULL || !glyph_font_init(&font, w, h)) {
+            SDL_Log("Unable to create %dx%d font", w, h);
+            return 1;
+        }
+
+        Uint32 seed = 1;
+        SDL_LockSurface(bitmap);
+        for (int c = 0; c < 256; c++) {
+            for (int y = 0; y < h; y++) {
+                for (int x = 0; x < w; x++) {
+                    seed = seed * 1664525 + 1013904223;
+                    const int set = seed >> 31;
+                    ((Uint8 *) bitmap->pixels)[(c / 16 * h + y) * bitmap->pitch + c % 16 * w + x] = set;
+                    if (set)
+                        glyph_setpixel(&font, c, x, y);
+                }
+            }
+        }
+        SDL_UnlockSurface(bitmap);
+        SDL_SetPaletteColors(bitmap->format->palette, colors[0], 0, 2);
+
+        const double reference = bench(draw_index8);
+        printf("%2dx%-2d %-18s %12.0f glyphs/s\n", w, h, "sdl index8", reference);
+
+        double rate = bench(draw_index8_recolor);
+        printf("%2dx%-2d %-18s %12.0f glyphs/s  x%.1f\n", w, h, "sdl index8 recolor", rate, rate / reference);
+
+        SDL_SetPaletteColors(bitmap->format->palette, colors[0], 0, 2);
+        atlas = SDL_ConvertSurface(bitmap, screen->format, 0);
+        if (atlas != NULL) {
+            SDL_SetSurfaceBlendMode(atlas, SDL_BLENDMODE_NONE);
+            rate = bench(draw_cached);
+            printf("%2dx%-2d %-18s %12.0f glyphs/s  x%.1f\n", w, h, "sdl cached", rate, rate / reference);
+            SDL_FreeSurface(atlas);
+        }
+
+        fg = SDL_MapRGB(screen->format, 0, 0, 0);
+        bg = SDL_MapRGB(screen->format, 255, 255, 255);
+        SDL_LockSurface(screen);
+        for (int k = GLYPH_KERNEL_SCALAR; k <= GLYPH_KERNEL_NEON; k++) {
+            if (!glyph_setkernel(&font, k))
+                continue;
+
+            rate = bench(draw_expand);
+            printf("%2dx%-2d %-18s %12.0f glyphs/s  x%.1f\n", w, h, kernel_names[k], rate, rate / reference);
+        }
+        SDL_UnlockSurface(screen);
+
+        glyph_font_free(&font);
+        SDL_FreeSurface(bitmap);
+    }
+
+    SDL_FreeSurface(screen);
+    return 0;
+}
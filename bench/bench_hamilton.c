@@ -0,0 +1,57 @@
+/* Ticks the Hamiltonian cycle solver takes to fill the board, on the sim_pool.
+ * Every game has to end WON, the ticks per game are the number to track over time. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <time.h>
+
+#include "ai.h"
+#include "sim.h"
+
+static const struct { int cols, rows; long games; } boards[] = {
+    { 50, 25, 64 }, { 51, 25, 64 }, { 200, 100, 2 },
+};
+
+static double seconds(struct timespec from) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - from.tv_sec) + (now.tv_nsec - from.tv_nsec) / 1e9;
+}
+
+static int bench(int cols, int rows, int level, long games) {
+    ai_cycle *c = ai_cycle_create(cols, rows, !levels[level].wall_collisions);
+    if (c == NULL)
+        return 1;
+
+    /* A lap of the cycle per food is the slowest it can go. */
+    long ncells = (long) cols * rows;
+    sim_config config = { .cols = cols, .rows = rows, .level = level, .seed = 1, .max_ticks = ncells * ncells };
+    sim_pool *p = sim_create(&config);
+    if (p == NULL) {
+        ai_cycle_destroy(c);
+        return 1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sim_result r = sim_run_until_done(p, games, ai_hamilton, c);
+    double elapsed = seconds(start);
+
+    printf("%3dx%-3d %-11s won %3ld/%-3ld %12.0f ticks/game %6.2f ticks/cell  %10.3e ticks/s\n",
+           cols, rows, levels[level].desc, r.won, r.games, (double) r.ticks / r.games,
+           (double) r.ticks / r.games / ncells, r.ticks / elapsed);
+
+    sim_destroy(p);
+    ai_cycle_destroy(c);
+    return r.won != r.games;
+}
+
+int main(void) {
+    int failed = 0;
+    for (size_t b = 0; b < sizeof(boards)/sizeof(*boards); b++)
+        for (int level = 0; level < 2; level++)
+            failed |= bench(boards[b].cols, boards[b].rows, level, boards[b].games);
+
+    return failed;
+}
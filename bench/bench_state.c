@@ -0,0 +1,163 @@
+/* Clones and steps per second for tree search: restoring a snapshot and stepping the copy,
+ * against stepping with an undo log and reverting, and a plain step for reference.
+ * Both ways of going back are checked to give the same state as before, and the incremental
+ * Zobrist hash to match game_hash() on every tick of games played from the root.
+ * Exits with 1 if any check fails. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "game.h"
+
+#define BENCH_SECONDS 0.5
+
+static const struct { int cols, rows; } sizes[] = {
+    { 50, 25 }, { 200, 100 },
+};
+
+/* Keeps the hashes from being optimized away. */
+static volatile uint64_t hash_sink;
+
+static double seconds(clock_t from) {
+    return (double) (clock() - from) / CLOCKS_PER_SEC;
+}
+
+/* Heads for the food, now and then at random, without running into the snake or a wall where it can. */
+static direction wander(const game_data *g, rng_state *rng) {
+    direction best = DIRECTION_NOVALUE;
+    int best_dist = 0;
+    for (int d = UP; d <= LEFT; d++) {
+        vec2i next = vec2i_step(g->snake.head_pos, d, 1);
+        if (next.x < 0 || next.x >= g->cols || next.y < 0 || next.y >= g->rows) {
+            if (levels[g->level].wall_collisions)
+                continue;
+            next = game_wrap(g, next);
+        }
+        if ((d ^ g->dir) == 2 || g->board[next.y*g->cols + next.x] == SNAKE)
+            continue;
+
+        int dist = abs(next.x - g->food.x) + abs(next.y - g->food.y) + rng_below(rng, 4);
+        if (best == DIRECTION_NOVALUE || dist < best_dist) {
+            best = d;
+            best_dist = dist;
+        }
+    }
+    return best;
+}
+
+/* Returns false if a check failed. */
+static bool bench_size(int cols, int rows, int level) {
+    game_data root = {0}, copy = {0};
+    game_init(&root, cols, rows, level, 1);
+    game_init(&copy, cols, rows, level, 2);
+
+    const size_t size = game_snapshot_size(cols, rows);
+    void *snap = malloc(size), *check = malloc(size);
+
+    /* The root is the longest running game seen in a while, so that the snake is not trivially short. */
+    rng_state rng;
+    rng_init(&rng, 3);
+    int longest = 0;
+    for (long t = 0; t < 1000000 && longest < cols * rows / 8; t++) {
+        if (game_step(&root, wander(&root, &rng)) != RUNNING)
+            game_reset(&root);
+        else if (root.snake.len > longest) {
+            longest = root.snake.len;
+            game_snapshot(&root, snap);
+        }
+    }
+    game_restore(&root, snap);
+
+    direction actions[256];
+    for (int i = 0; i < 256; i++)
+        actions[i] = rng_below(&rng, 8) < 4 ? (direction) rng_below(&rng, 4) : DIRECTION_NOVALUE;
+
+    /* Restore the root into the copy and take one step. */
+    long n = 0;
+    clock_t start = clock();
+    do {
+        for (int i = 0; i < 256; i++) {
+            game_restore(&copy, snap);
+            game_step(&copy, actions[i]);
+        }
+        n += 256;
+    } while (seconds(start) < BENCH_SECONDS);
+    double restore_rate = n / seconds(start);
+
+    game_restore(&copy, snap);
+    game_snapshot(&copy, check);
+    bool restore_ok = memcmp(snap, check, size) == 0;
+
+    /* Step the root itself and revert the step. */
+    game_undo undo;
+    n = 0;
+    start = clock();
+    do {
+        for (int i = 0; i < 256; i++) {
+            game_step_record(&root, actions[i], &undo);
+            game_undo_step(&root, &undo);
+        }
+        n += 256;
+    } while (seconds(start) < BENCH_SECONDS);
+    double undo_rate = n / seconds(start);
+
+    game_snapshot(&root, check);
+    bool undo_ok = memcmp(snap, check, size) == 0;
+
+    /* A step on its own, games that end are restarted. */
+    n = 0;
+    start = clock();
+    do {
+        for (int i = 0; i < 256; i++)
+            if (game_step(&copy, actions[i]) != RUNNING)
+                game_restore(&copy, snap);
+        n += 256;
+    } while (seconds(start) < BENCH_SECONDS);
+    double step_rate = n / seconds(start);
+
+    /* The hash from scratch, once on its own and then against the incremental one. */
+    n = 0;
+    start = clock();
+    do {
+        for (int i = 0; i < 256; i++)
+            hash_sink = game_hash(&root);
+        n += 256;
+    } while (seconds(start) < BENCH_SECONDS);
+    double hash_rate = n / seconds(start);
+
+    long hash_ticks = 0, hash_mismatches = 0;
+    game_restore(&copy, snap);
+    for (int t = 0; t < 1000000; t++) {
+        if (game_step(&copy, wander(&copy, &rng)) == LOST) {
+            game_restore(&copy, snap);
+            continue;
+        }
+        hash_mismatches += copy.hash != game_hash(&copy);
+        hash_ticks++;
+        if (copy.state == WON)
+            game_restore(&copy, snap);
+    }
+
+    printf("%3dx%-3d %-11s len %5d snapshot %6zu bytes\n", cols, rows, levels[level].desc, root.snake.len, size);
+    printf("    restore+step %12.3e /s %s\n", restore_rate, restore_ok ? "" : "MISMATCH");
+    printf("    step+undo    %12.3e /s %s\n", undo_rate, undo_ok ? "" : "MISMATCH");
+    printf("    step         %12.3e /s\n", step_rate);
+    printf("    game_hash    %12.3e /s %ld ticks checked %s\n", hash_rate, hash_ticks, hash_mismatches ? "MISMATCH" : "");
+
+    free(snap);
+    free(check);
+    game_free(&root);
+    game_free(&copy);
+    return restore_ok && undo_ok && hash_mismatches == 0;
+}
+
+int main(void) {
+    bool ok = true;
+    for (size_t s = 0; s < sizeof(sizes)/sizeof(*sizes); s++)
+        for (int level = 0; level < 2; level++)
+            ok &= bench_size(sizes[s].cols, sizes[s].rows, level);
+
+    return ok ? 0 : 1;
+}
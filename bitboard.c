@@ -0,0 +1,126 @@
+#include <string.h>
+
+#include "bitboard.h"
+
+void bitboard_clear(bitboard *b, int cols, int rows) {
+    b->cols = cols;
+    b->rows = rows;
+    memset(b->row, 0, rows * sizeof(uint64_t));
+}
+
+void bitboard_fill(bitboard *b, int cols, int rows) {
+    b->cols = cols;
+    b->rows = rows;
+    const uint64_t mask = bitboard_mask(b);
+    for (int y = 0; y < rows; y++)
+        b->row[y] = mask;
+}
+
+int bitboard_popcount(const bitboard *b) {
+    int n = 0;
+    for (int y = 0; y < b->rows; y++)
+        n += bitboard_popcount64(b->row[y]);
+    return n;
+}
+
+bool bitboard_intersects(const bitboard *a, const bitboard *b) {
+    uint64_t any = 0;
+    for (int y = 0; y < a->rows; y++)
+        any |= a->row[y] & b->row[y];
+    return any != 0;
+}
+
+/* The cells left and right of the ones in w. */
+static inline uint64_t row_sides(uint64_t w, int cols, bool wrap) {
+    uint64_t sides = w << 1 | w >> 1;
+    if (wrap)
+        sides |= w >> (cols - 1) | w << (cols - 1);
+    return sides;
+}
+
+void bitboard_neighbours(bitboard *dst, const bitboard *src, bool wrap) {
+    const int cols = src->cols, rows = src->rows;
+    const uint64_t mask = bitboard_mask(src);
+
+    /* Reads a row ahead of the one written, so that it works in place. */
+    const uint64_t first = src->row[0];
+    uint64_t above = wrap ? src->row[rows-1] : 0, cur = first;
+    for (int y = 0; y < rows; y++) {
+        uint64_t below = y + 1 < rows ? src->row[y+1] : wrap ? first : 0;
+        dst->row[y] = (above | below | row_sides(cur, cols, wrap)) & mask;
+        above = cur;
+        cur = below;
+    }
+
+    dst->cols = cols;
+    dst->rows = rows;
+}
+
+int bitboard_free_neighbours(const bitboard *open, vec2i v, bool wrap) {
+    const int cols = open->cols, rows = open->rows;
+    const uint64_t bit = (uint64_t) 1 << v.x;
+
+    int up = v.y > 0 ? v.y - 1 : wrap ? rows - 1 : -1;
+    int down = v.y + 1 < rows ? v.y + 1 : wrap ? 0 : -1;
+
+    int n = bitboard_popcount64(row_sides(bit, cols, wrap) & bitboard_mask(open) & open->row[v.y]);
+    if (up >= 0)
+        n += open->row[up] >> v.x & 1;
+    if (down >= 0 && down != up)
+        n += open->row[down] >> v.x & 1;
+    return n;
+}
+
+/* Adds the open neighbours of reach to it. Returns false if there were none left. */
+static bool flood_step(bitboard *reach, const bitboard *open, bool wrap) {
+    const int cols = reach->cols, rows = reach->rows;
+
+    const uint64_t first = reach->row[0];
+    uint64_t above = wrap ? reach->row[rows-1] : 0, cur = first, grown = 0;
+    for (int y = 0; y < rows; y++) {
+        uint64_t below = y + 1 < rows ? reach->row[y+1] : wrap ? first : 0;
+        uint64_t add = (above | below | row_sides(cur, cols, wrap)) & open->row[y] & ~cur;
+        reach->row[y] = cur | add;
+        grown |= add;
+        above = cur;
+        cur = below;
+    }
+
+    return grown != 0;
+}
+
+int bitboard_flood(bitboard *reach, const bitboard *open, bool wrap) {
+    while (flood_step(reach, open, wrap));
+    return bitboard_popcount(reach);
+}
+
+int bitboard_distance(const bitboard *from, const bitboard *to, const bitboard *open, bool wrap) {
+    /* Breadth-first: every step adds the cells one move further away. */
+    bitboard reach = *from;
+    for (int d = 0; ; d++) {
+        if (bitboard_intersects(&reach, to))
+            return d;
+        if (!flood_step(&reach, open, wrap))
+            return -1;
+    }
+}
+
+bool bitboard_fromgame(game_bitboards *bb, const game_data *g) {
+    if (!bitboard_fits(g->cols, g->rows))
+        return false;
+
+    bitboard_clear(&bb->body, g->cols, g->rows);
+    for (game_iter it = game_iter_begin(g); it.i < g->snake.len; game_iter_next(g, &it))
+        bitboard_set(&bb->body, it.pos);
+
+    bitboard_clear(&bb->food, g->cols, g->rows);
+    if (g->state != WON)
+        bitboard_set(&bb->food, g->food);
+
+    bitboard_fill(&bb->open, g->cols, g->rows);
+    for (int y = 0; y < g->rows; y++)
+        bb->open.row[y] &= ~bb->body.row[y];
+
+    bb->wrap = !levels[g->level].wall_collisions;
+    return true;
+}
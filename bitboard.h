@@ -0,0 +1,83 @@
+#ifndef SNAKERL_BITBOARD_H
+#define SNAKERL_BITBOARD_H
+
+/* Sets of board cells as one 64-bit word per row, bit x of a row is column x.
+ * Moving a set by one cell is a shift of the words, so collision checks, free neighbour counts
+ * and flood fills take a few word operations per row instead of a scan over the cells. */
+
+#include "game.h"
+
+#define BITBOARD_MAX_COLS 64
+#define BITBOARD_MAX_ROWS 128
+
+typedef struct {
+    int cols, rows;
+    uint64_t row[BITBOARD_MAX_ROWS];
+} bitboard;
+
+/* The cells of a game and the ones its snake can still move into.
+ * The board has no walls inside, the edges are the bits beyond cols and rows (see bitboard_mask()).
+ * Moves pass them on a level without wall collisions, so the helpers below take a wrap flag. */
+typedef struct {
+    bitboard body;
+    bitboard food;
+    bitboard open; /* Cells on the board not taken by the body. */
+    bool wrap;
+} game_bitboards;
+
+static inline bool bitboard_fits(int cols, int rows) {
+    return cols > 0 && cols <= BITBOARD_MAX_COLS && rows > 0 && rows <= BITBOARD_MAX_ROWS;
+}
+
+/* The bits of a row that are on the board. */
+static inline uint64_t bitboard_mask(const bitboard *b) {
+    return b->cols == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << b->cols) - 1;
+}
+
+static inline int bitboard_popcount64(uint64_t w) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(w);
+#else
+    w = w - ((w >> 1) & 0x5555555555555555ULL);
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (w * 0x0101010101010101ULL) >> 56;
+#endif
+}
+
+static inline bool bitboard_get(const bitboard *b, vec2i v) {
+    return b->row[v.y] >> v.x & 1;
+}
+
+static inline void bitboard_set(bitboard *b, vec2i v) {
+    b->row[v.y] |= (uint64_t) 1 << v.x;
+}
+
+static inline void bitboard_unset(bitboard *b, vec2i v) {
+    b->row[v.y] &= ~((uint64_t) 1 << v.x);
+}
+
+/* Empties the set and sets its size. */
+void bitboard_clear(bitboard *b, int cols, int rows);
+void bitboard_fill(bitboard *b, int cols, int rows);
+
+int bitboard_popcount(const bitboard *b);
+bool bitboard_intersects(const bitboard *a, const bitboard *b);
+
+/* The cells next to any cell of src in one of the four directions. dst may be src. */
+void bitboard_neighbours(bitboard *dst, const bitboard *src, bool wrap);
+
+/* The number of cells of open next to v. */
+int bitboard_free_neighbours(const bitboard *open, vec2i v, bool wrap);
+
+/* Grows reach over the cells of open it can get to, reach itself needs not be open.
+ * Returns the number of cells in the result. */
+int bitboard_flood(bitboard *reach, const bitboard *open, bool wrap);
+
+/* The number of moves over open cells from any cell of from to any cell of to, -1 if there is no way. */
+int bitboard_distance(const bitboard *from, const bitboard *to, const bitboard *open, bool wrap);
+
+/* Derives the masks from the game. Returns false if the board is too large for a bitboard. */
+bool bitboard_fromgame(game_bitboards *bb, const game_data *g);
+
+#endif
@@ -2,6 +2,7 @@
 #define SNAKERL_CONST_H
 
 #include <stdbool.h>
+#include "game.h"
 #include "ui.h"
 
 /* General constants */
@@ -39,19 +40,10 @@ static const ui_color color_message = { 255,   0,   0 };
 /* Global strings */
 static const char pause_str[] = "*PAUSE*";
 static const char lost_str[] = "Game Over.";
+static const char won_str[] = "You Win!";
 static const char menu_str[] = "Select the difficulty level:";
 
-/* Difficulty levels */
-struct level {
-    const char *desc;
-    unsigned int update_ms;
-    bool wall_collisions;
-};
-
-extern const struct level levels[];
-extern const int nlevels;
-
 /* Utility functions. */
-char segment_symbol(size_t i);
+char segment_symbol(const game_data *g, int i);
 
 #endif
@@ -0,0 +1,164 @@
+#include <string.h>
+
+#include "fx.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define FX_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FX_NEON
+#include <arm_neon.h>
+#endif
+
+static int mask_shift(uint32_t mask) {
+    int shift = 0;
+    while (shift < 32 && !(mask & (1u << shift)))
+        shift++;
+    return shift;
+}
+
+static void fx_crt_row_scalar(const fx_crt *crt, uint32_t *pixels, int n, int phase) {
+    const int s0 = crt->shift[phase][0], s1 = crt->shift[phase][1];
+    const uint32_t keep = ~((0xFFu << s0) | (0xFFu << s1));
+    const uint8_t *scale = crt->scale;
+
+    for (int i = 0; i < n; i++) {
+        uint32_t p = pixels[i];
+        pixels[i] = (p & keep) |
+            (uint32_t) scale[(p >> s0) & 0xFF] << s0 |
+            (uint32_t) scale[(p >> s1) & 0xFF] << s1;
+    }
+}
+
+#ifdef FX_X86
+
+__attribute__((target("sse2")))
+static void fx_crt_row_sse2(const fx_crt *crt, uint32_t *pixels, int n, int phase) {
+    const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi16(255);
+    const __m128i m = _mm_unpacklo_epi8(_mm_set1_epi32(crt->pattern[phase]), zero);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i *) (pixels + i));
+        __m128i lo = _mm_unpacklo_epi8(p, zero), hi = _mm_unpackhi_epi8(p, zero);
+        lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, m), round), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, m), round), 8);
+        _mm_storeu_si128((__m128i *) (pixels + i), _mm_sub_epi8(p, _mm_packus_epi16(lo, hi)));
+    }
+
+    fx_crt_row_scalar(crt, pixels + i, n - i, phase);
+}
+
+__attribute__((target("avx2")))
+static void fx_crt_row_avx2(const fx_crt *crt, uint32_t *pixels, int n, int phase) {
+    const __m256i zero = _mm256_setzero_si256(), round = _mm256_set1_epi16(255);
+    const __m256i m = _mm256_unpacklo_epi8(_mm256_set1_epi32(crt->pattern[phase]), zero);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i *) (pixels + i));
+        __m256i lo = _mm256_unpacklo_epi8(p, zero), hi = _mm256_unpackhi_epi8(p, zero);
+        lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(lo, m), round), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(hi, m), round), 8);
+        _mm256_storeu_si256((__m256i *) (pixels + i), _mm256_sub_epi8(p, _mm256_packus_epi16(lo, hi)));
+    }
+
+    fx_crt_row_scalar(crt, pixels + i, n - i, phase);
+}
+
+#endif
+
+#ifdef FX_NEON
+
+static void fx_crt_row_neon(const fx_crt *crt, uint32_t *pixels, int n, int phase) {
+    const uint8x16_t m = vreinterpretq_u8_u32(vdupq_n_u32(crt->pattern[phase]));
+    const uint16x8_t round = vdupq_n_u16(255);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint8x16_t p = vld1q_u8((const uint8_t *) (pixels + i));
+        uint16x8_t lo = vmull_u8(vget_low_u8(p), vget_low_u8(m));
+        uint16x8_t hi = vmull_u8(vget_high_u8(p), vget_high_u8(m));
+        uint8x16_t d = vcombine_u8(vaddhn_u16(lo, round), vaddhn_u16(hi, round));
+        vst1q_u8((uint8_t *) (pixels + i), vsubq_u8(p, d));
+    }
+
+    fx_crt_row_scalar(crt, pixels + i, n - i, phase);
+}
+
+#endif
+
+bool fx_crt_setkernel(fx_crt *crt, fx_kernel kernel) {
+#ifdef FX_X86
+    __builtin_cpu_init();
+    bool has_avx2 = __builtin_cpu_supports("avx2");
+    bool has_sse2 = __builtin_cpu_supports("sse2");
+#endif
+
+    fx_row_fn row = NULL;
+    switch (kernel) {
+    case FX_KERNEL_AUTO:
+#if defined(FX_X86)
+        row = has_avx2 ? fx_crt_row_avx2 : has_sse2 ? fx_crt_row_sse2 : fx_crt_row_scalar;
+#elif defined(FX_NEON)
+        row = fx_crt_row_neon;
+#else
+        row = fx_crt_row_scalar;
+#endif
+        break;
+    case FX_KERNEL_SCALAR:
+        row = fx_crt_row_scalar;
+        break;
+#ifdef FX_X86
+    case FX_KERNEL_SSE2:
+        row = has_sse2 ? fx_crt_row_sse2 : NULL;
+        break;
+    case FX_KERNEL_AVX2:
+        row = has_avx2 ? fx_crt_row_avx2 : NULL;
+        break;
+#endif
+#ifdef FX_NEON
+    case FX_KERNEL_NEON:
+        row = fx_crt_row_neon;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    if (row == NULL)
+        return false;
+
+    crt->row = row;
+    return true;
+}
+
+void fx_crt_init(fx_crt *crt, double intensity, uint32_t rmask, uint32_t gmask, uint32_t bmask) {
+    crt->intensity = intensity;
+    crt->rmask = rmask;
+    crt->gmask = gmask;
+    crt->bmask = bmask;
+
+    /* Dimming by m/256, rounded to the nearest step. */
+    int m = (int) (intensity * 256 + 0.5);
+    crt->m = m < 0 ? 0 : m > 255 ? 255 : m;
+    for (int c = 0; c < 256; c++)
+        crt->scale[c] = c - ((c * crt->m + 255) >> 8);
+
+    /* Row phases: red and green, red and blue, green and blue. */
+    const int r = mask_shift(rmask), g = mask_shift(gmask), b = mask_shift(bmask);
+    const int shifts[3][2] = { { r, g }, { r, b }, { g, b } };
+    for (int phase = 0; phase < 3; phase++) {
+        crt->shift[phase][0] = shifts[phase][0];
+        crt->shift[phase][1] = shifts[phase][1];
+        crt->pattern[phase] = (uint32_t) crt->m << shifts[phase][0] | (uint32_t) crt->m << shifts[phase][1];
+    }
+
+    fx_crt_setkernel(crt, FX_KERNEL_AUTO);
+}
+
+void fx_crt_apply(const fx_crt *crt, void *pixels, int pitch, int x, int y, int w, int h) {
+    uint8_t *row = (uint8_t *) pixels + (size_t) y * pitch + (size_t) x * sizeof(uint32_t);
+    for (int i = 0; i < h; i++, row += pitch)
+        crt->row(crt, (uint32_t *) row, w, (y + i) % 3);
+}
@@ -0,0 +1,40 @@
+#ifndef SNAKERL_FX_H
+#define SNAKERL_FX_H
+
+/* Post-processing kernels working directly on 32-bit pixels with 8-bit channels.
+ * No SDL dependency, the caller passes the channel masks of the surface format. */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    FX_KERNEL_AUTO, FX_KERNEL_SCALAR, FX_KERNEL_SSE2, FX_KERNEL_AVX2, FX_KERNEL_NEON
+} fx_kernel;
+
+struct fx_crt;
+typedef void (*fx_row_fn)(const struct fx_crt *crt, uint32_t *pixels, int n, int phase);
+
+/* The CRT effect: rows cycle through three phases, each dims two of the three color channels.
+ * A channel value c becomes c - (c*m + 255)/256, the table and the SIMD kernels give the same result. */
+typedef struct fx_crt {
+    double intensity;
+    uint32_t rmask, gmask, bmask;
+    uint8_t m;
+    uint8_t scale[256];   /* Dimmed value of each channel value. */
+    int shift[3][2];      /* Dimmed channels of each phase. */
+    uint32_t pattern[3];  /* m in the bytes of the dimmed channels of each phase. */
+    fx_row_fn row;
+} fx_crt;
+
+/* Precomputes the tables for the given intensity and channel masks (each must cover one whole byte)
+ * and selects the fastest kernel supported by the CPU. */
+void fx_crt_init(fx_crt *crt, double intensity, uint32_t rmask, uint32_t gmask, uint32_t bmask);
+
+/* Selects a specific kernel. Returns false if the CPU does not support it. */
+bool fx_crt_setkernel(fx_crt *crt, fx_kernel kernel);
+
+/* Applies the effect to the w x h rectangle at (x, y) of a pixel buffer with the given pitch in bytes.
+ * The phase of a row follows its y coordinate. */
+void fx_crt_apply(const fx_crt *crt, void *pixels, int pitch, int x, int y, int w, int h);
+
+#endif
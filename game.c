@@ -1,72 +1,175 @@
-#include <stdbool.h>
+#include <stdlib.h>
 #include <assert.h>
-#include <time.h>
+#include <string.h>
 
 #include "game.h"
-#include "const.h"
 
-typedef enum {
-    EMPTY, SNAKE, WALL, FOOD
-} cell_type;
+const struct level levels[] = {
+    { "EASY", 200, false },
+    { "HARD", 100, true },
+    { "CHALLENGING", 75, true },
+};
 
-/* The g.state is RESTART by default. */
-game_data g = { 0 };
+const int nlevels = sizeof(levels)/sizeof(*levels);
 
-static bool force_update = false;
+/* Zobrist keys are drawn from SplitMix64 by what they stand for, no table is kept. */
+enum { ZOBRIST_SEGMENT = 0, ZOBRIST_HEAD = 4, ZOBRIST_FOOD, ZOBRIST_DIR = 8 };
 
-void game_setdirection(direction newdir) {
-    if (((newdir == UP || newdir == DOWN) && (g.dir == LEFT || g.dir == RIGHT)) ||
-        ((newdir == LEFT || newdir == RIGHT) && (g.dir == UP || g.dir == DOWN))) {
-        force_update = true;
-        g.dir = newdir;
+static inline uint64_t zobrist(int cell, int what) {
+    return rng_seed(0x5EED5A4E5EED5A4EULL, (uint64_t) cell * 16 + what);
+}
+
+static inline int game_cell(const game_data *g, vec2i v) {
+    return v.y*g->cols + v.x;
+}
+
+uint64_t game_hash(const game_data *g) {
+    uint64_t hash = zobrist(0, ZOBRIST_DIR + g->dir);
+    if (g->state != WON)
+        hash ^= zobrist(game_cell(g, g->food), ZOBRIST_FOOD);
+
+    game_iter it = game_iter_begin(g);
+    hash ^= zobrist(game_cell(g, it.pos), ZOBRIST_HEAD);
+    for (game_iter_next(g, &it); it.i < g->snake.len; game_iter_next(g, &it))
+        hash ^= zobrist(game_cell(g, it.pos), ZOBRIST_SEGMENT + game_segment_dir(g, it.i-1));
+
+    return hash;
+}
+
+bool game_setdirection(game_data *g, direction newdir) {
+    if (((newdir == UP || newdir == DOWN) && (g->dir == LEFT || g->dir == RIGHT)) ||
+        ((newdir == LEFT || newdir == RIGHT) && (g->dir == UP || g->dir == DOWN))) {
+        g->hash ^= zobrist(0, ZOBRIST_DIR + g->dir) ^ zobrist(0, ZOBRIST_DIR + newdir);
+        g->dir = newdir;
+        return true;
+    }
+
+    return false;
+}
+
+/* What an entry of the undo log overwrote. */
+enum { UNDO_BOARD, UNDO_CELL, UNDO_POS, UNDO_DIRS };
+
+static inline void undo_log(game_undo *undo, int what, int index, int old) {
+    if (undo != NULL) {
+        assert(undo->nwrites < GAME_UNDO_MAX_WRITES);
+        undo->write[undo->nwrites].what = what;
+        undo->write[undo->nwrites].index = index;
+        undo->write[undo->nwrites].old = old;
+        undo->nwrites++;
+    }
+}
+
+static void snake_setdir(game_data *g, int i, direction dir, game_undo *undo) {
+    undo_log(undo, UNDO_DIRS, i >> 2, g->snake.dir[i >> 2]);
+    dirs_set(g->snake.dir, i, dir);
+}
+
+/* Changes the type of the cell under v, keeping the set of vacant cells in sync.
+ * Vacant cells are kept densely packed, an occupied cell is swapped with the last one. */
+static void board_set(game_data *g, vec2i v, cell_type type, game_undo *undo) {
+    int cell = v.y*g->cols + v.x;
+    bool was_vacant = g->board[cell] == EMPTY;
+    undo_log(undo, UNDO_BOARD, cell, g->board[cell]);
+    g->board[cell] = type;
+
+    if (was_vacant && type != EMPTY) {
+        int last = g->vacant.cell[--g->vacant.len];
+        int pos = g->vacant.pos[cell];
+        undo_log(undo, UNDO_CELL, pos, g->vacant.cell[pos]);
+        undo_log(undo, UNDO_POS, last, g->vacant.pos[last]);
+        g->vacant.cell[pos] = last;
+        g->vacant.pos[last] = pos;
+    } else if (!was_vacant && type == EMPTY) {
+        undo_log(undo, UNDO_POS, cell, g->vacant.pos[cell]);
+        undo_log(undo, UNDO_CELL, g->vacant.len, g->vacant.cell[g->vacant.len]);
+        g->vacant.pos[cell] = g->vacant.len;
+        g->vacant.cell[g->vacant.len++] = cell;
     }
 }
 
-static cell_type cell_gettype(vec2i v) {
-    if (v.x == g.food.x && v.y == g.food.y)
-        return FOOD;
+static cell_type cell_gettype(const game_data *g, vec2i v) {
+    if (v.x >= g->cols || v.x < 0 ||
+        v.y >= g->rows || v.y < 0) return WALL;
 
-    if (v.x >= ui_cols || v.x < 0 ||
-        v.y >= ui_rows || v.y < 0) return WALL;
+    return g->board[v.y*g->cols + v.x];
+}
 
-    for (size_t i = 1; i < g.snake.len; i++) {
-        if (v.x == g.snake.seg[i].x && v.y == g.snake.seg[i].y)
-            return SNAKE;
+static void food_generate(game_data *g, game_undo *undo) {
+    /* No space left for the food means the snake has filled the board. */
+    if (g->vacant.len == 0) {
+        g->state = WON;
+        return;
     }
 
-    return EMPTY;
+    /* Pick a random vacant tile. */
+    int cell = g->vacant.cell[rng_below(&g->rng, g->vacant.len)];
+    g->food = (vec2i) { cell % g->cols, cell / g->cols };
+    g->hash ^= zobrist(cell, ZOBRIST_FOOD);
+    board_set(g, g->food, FOOD, undo);
 }
 
-static void snake_push(vec2i segment) {
+static void snake_push(game_data *g, vec2i segment, direction dir, game_undo *undo) {
     /* Allocate/reallocate if needed. */
-    if (g.snake.len >= g.snake.cap) {
-        g.snake.cap = g.snake.cap == 0 ? 64 : g.snake.cap * 2;
-        g.snake.seg = realloc(g.snake.seg, g.snake.cap * sizeof(vec2i));
+    if (g->snake.len >= g->snake.cap) {
+        int oldcap = g->snake.cap;
+        g->snake.cap = g->snake.cap == 0 ? 64 : g->snake.cap * 2;
+        g->snake.dir = realloc(g->snake.dir, g->snake.cap / 4);
+        /* Cleared, so that a restored game snapshots to the same bytes. */
+        memset(g->snake.dir + oldcap / 4, 0, (g->snake.cap - oldcap) / 4);
+
+        /* The ring was full, so the part wrapped around to the beginning
+         * of the buffer is moved right behind the old end to keep it contiguous.
+         * The old part stays as it was, an undo only has to restore the capacity. */
+        for (int i = 0; i < g->snake.head; i++)
+            dirs_set(g->snake.dir, oldcap + i, dirs_get(g->snake.dir, i));
     }
 
-    g.snake.seg[g.snake.len++] = segment;
+    /* Append to the tail. */
+    snake_setdir(g, (g->snake.head + g->snake.len++) & (g->snake.cap - 1), dir, undo);
+    g->snake.tail_pos = segment;
+    board_set(g, segment, SNAKE, undo);
 }
 
-static void game_init() {
-    srand(time(NULL));
+static void game_start(game_data *g, uint64_t seed) {
+    g->seed = seed;
+    rng_init(&g->rng, seed);
 
     /* Randomize initial parameters. */
-    g.dir = rand() % 4;
-    g.food = (vec2i) { rand() % ui_cols, rand() % ui_rows };
+    g->dir = rng_below(&g->rng, 4);
+
+    /* Allocate (if needed) and clear the occupancy grid. */
+    int ncells = g->cols * g->rows;
+    if (g->vacant.len_max != ncells) {
+        g->board = realloc(g->board, ncells);
+        g->vacant.cell = realloc(g->vacant.cell, ncells * sizeof(int));
+        g->vacant.pos = realloc(g->vacant.pos, ncells * sizeof(int));
+        g->vacant.len_max = ncells;
+    }
+
+    memset(g->board, EMPTY, ncells);
+    for (int i = 0; i < ncells; i++) {
+        g->vacant.cell[i] = i;
+        g->vacant.pos[i] = i;
+    }
+    g->vacant.len = ncells;
 
     /* Reset the snake length. */
-    g.snake.len = 0;
+    g->snake.head = 0;
+    g->snake.len = 0;
+    g->ticks = 0;
 
     vec2i seg = {
-        rand() % (ui_cols/2) + ui_cols/4,
-        rand() % (ui_rows/2) + ui_rows/4,
+        rng_below(&g->rng, g->cols/2) + g->cols/4,
+        rng_below(&g->rng, g->rows/2) + g->rows/4,
     };
 
     /* Allocate (if needed) the snake and add the initial segment. */
-    snake_push(seg);
+    snake_push(g, seg, g->dir, NULL);
+    g->snake.head_pos = seg;
 
     /* Generate a tail in opposite direction of the initial movement. */
-    switch (g.dir) {
+    switch (g->dir) {
     case UP:    seg.y++; break;
     case RIGHT: seg.x--; break;
     case DOWN:  seg.y--; break;
@@ -74,94 +177,266 @@ static void game_init() {
     default: assert(0);
     }
 
-    snake_push(seg);
+    snake_push(g, seg, g->dir, NULL);
 
-    g.state = MENU;
+    g->state = RUNNING;
+    food_generate(g, NULL);
+    g->hash = game_hash(g);
 }
 
-static void game_update() {
-    /* Move the tail part of the snake. */
-    vec2i last = g.snake.seg[g.snake.len-1];
-    for (size_t i = g.snake.len-1; i > 0; i--) {
-        g.snake.seg[i] = g.snake.seg[i-1];
-    }
+void game_init(game_data *g, int cols, int rows, int level, uint64_t seed) {
+    assert(cols >= GAME_MIN_SIZE && rows >= GAME_MIN_SIZE);
+    g->cols = cols;
+    g->rows = rows;
+    g->level = level;
+
+    game_start(g, seed);
+}
+
+void game_reset(game_data *g) {
+    game_start(g, rng_next64(&g->rng));
+}
+
+static void game_update(game_data *g, game_undo *undo) {
+    /* Move the snake: the new head takes the slot in front of the old one,
+     * which drops the last segment of the tail off the ring. */
+    vec2i last = g->snake.tail_pos;
+    direction last_dir = game_segment_dir(g, g->snake.len-1);
 
     /* The position of the head after the movement. */
-    switch (g.dir) {
-    case UP:    g.snake.seg[0].y--; break;
-    case RIGHT: g.snake.seg[0].x++; break;
-    case DOWN:  g.snake.seg[0].y++; break;
-    case LEFT:  g.snake.seg[0].x--; break;
-    default:
-        assert(0);
-    }
+    assert(g->dir >= UP && g->dir <= LEFT);
+    vec2i next = vec2i_step(g->snake.head_pos, g->dir, 1);
 
-    /* If the wall collisions are disabled, make a transition to the opposite wall. */
-    cell_type head_cell = cell_gettype(g.snake.seg[0]);
-    if (head_cell == WALL && levels[g.level].wall_collisions == false) {
-        if (g.snake.seg[0].x >= ui_cols || g.snake.seg[0].x < 0) {
-            g.snake.seg[0].x += ui_cols;
-            g.snake.seg[0].x %= ui_cols;
-        }
+    g->snake.head = (g->snake.head - 1) & (g->snake.cap - 1);
+    snake_setdir(g, g->snake.head, g->dir, undo);
+    g->ticks++;
 
-        if (g.snake.seg[0].y >= ui_rows || g.snake.seg[0].y < 0) {
-            g.snake.seg[0].y += ui_rows;
-            g.snake.seg[0].y %= ui_rows;
-        }
+    /* The old head is left in the direction of the new one. */
+    int head = game_cell(g, g->snake.head_pos);
+    g->hash ^= zobrist(head, ZOBRIST_HEAD) ^ zobrist(head, ZOBRIST_SEGMENT + g->dir);
+
+    /* The tail moves out of its cell towards the segment in front of it, so the head may enter it. */
+    direction tail_dir = game_segment_dir(g, g->snake.len-1);
+    uint64_t tail_key = zobrist(game_cell(g, last), ZOBRIST_SEGMENT + tail_dir);
+    g->snake.tail_pos = game_wrap(g, vec2i_step(last, tail_dir, 1));
+    g->hash ^= tail_key;
+    board_set(g, last, EMPTY, undo);
 
-        head_cell = cell_gettype(g.snake.seg[0]);
+    /* If the wall collisions are disabled, make a transition to the opposite wall. */
+    cell_type head_cell = cell_gettype(g, next);
+    if (head_cell == WALL && levels[g->level].wall_collisions == false) {
+        next = game_wrap(g, next);
+        head_cell = cell_gettype(g, next);
     }
+    g->snake.head_pos = next;
 
     /* Check if the game is over. */
-    if (head_cell == SNAKE || (levels[g.level].wall_collisions ? head_cell == WALL : false)) {
-        g.state = LOST;
+    if (head_cell == SNAKE || (levels[g->level].wall_collisions ? head_cell == WALL : false)) {
+        g->state = LOST;
         return;
     }
 
+    board_set(g, next, SNAKE, undo);
+    g->hash ^= zobrist(game_cell(g, next), ZOBRIST_HEAD);
+
     if (head_cell == FOOD) {
-        snake_push(last);
-
-        /* Generate new food. Make sure it generates on empty tile. */
-        vec2i newfood;
-        do {
-            newfood = (vec2i) { rand() % ui_cols, rand() % ui_rows };
-        } while (cell_gettype(newfood) != EMPTY);
-        g.food = newfood;
+        g->hash ^= zobrist(game_cell(g, next), ZOBRIST_FOOD) ^ tail_key;
+        snake_push(g, last, last_dir, undo);
+        food_generate(g, undo);
     }
 }
 
-void game_quit(void) {
-    g.state = QUIT;
-    free(g.snake.seg);
+game_state game_step(game_data *g, direction action) {
+    if (g->state != RUNNING)
+        return g->state;
+
+    if (action != DIRECTION_NOVALUE)
+        game_setdirection(g, action);
+
+    game_update(g, NULL);
+    return g->state;
 }
 
-void game_run(void (*eventpoll)(void), void (*draw)(void)) {
-    uint32_t last_ticks = SDL_GetTicks();
-    while (g.state != QUIT) {
-        if (g.state == INIT) {
-            game_init();
-            continue;
-        }
-        
-        eventpoll();
-
-        if (g.state == MENU) {
-            if ((signed int) g.level > nlevels-1)
-                g.level = 0;
-            else if ((signed int) g.level < 0)
-                g.level = nlevels-1;
-        } else if (g.state == RUNNING) {
-            uint32_t now_ticks = SDL_GetTicks();
-            if (force_update || now_ticks - last_ticks > levels[g.level].update_ms) {
-                /* Update. */
-                force_update = false;
-                last_ticks = now_ticks;
-                game_update();
-            }
-        }
+game_state game_step_record(game_data *g, direction action, game_undo *undo) {
+    undo->nwrites = 0;
+    undo->state = g->state;
+    undo->dir = g->dir;
+    undo->head_pos = g->snake.head_pos;
+    undo->tail_pos = g->snake.tail_pos;
+    undo->food = g->food;
+    undo->head = g->snake.head;
+    undo->len = g->snake.len;
+    undo->cap = g->snake.cap;
+    undo->vacant_len = g->vacant.len;
+    undo->rng = g->rng;
+    undo->ticks = g->ticks;
+    undo->hash = g->hash;
+
+    if (g->state != RUNNING)
+        return g->state;
+
+    if (action != DIRECTION_NOVALUE)
+        game_setdirection(g, action);
+
+    game_update(g, undo);
+    return g->state;
+}
 
-        draw();
+void game_undo_step(game_data *g, const game_undo *undo) {
+    for (int i = undo->nwrites - 1; i >= 0; i--) {
+        int index = undo->write[i].index, old = undo->write[i].old;
+        switch (undo->write[i].what) {
+        case UNDO_BOARD: g->board[index] = old; break;
+        case UNDO_CELL:  g->vacant.cell[index] = old; break;
+        case UNDO_POS:   g->vacant.pos[index] = old; break;
+        case UNDO_DIRS:  g->snake.dir[index] = old; break;
+        default: assert(0);
+        }
     }
 
-    game_quit();
+    g->state = undo->state;
+    g->dir = undo->dir;
+    g->snake.head_pos = undo->head_pos;
+    g->snake.tail_pos = undo->tail_pos;
+    g->food = undo->food;
+    g->snake.head = undo->head;
+    g->snake.len = undo->len;
+    /* A ring that has grown keeps its memory, the old part of it is unchanged. */
+    g->snake.cap = undo->cap;
+    g->vacant.len = undo->vacant_len;
+    g->rng = undo->rng;
+    g->ticks = undo->ticks;
+    g->hash = undo->hash;
+}
+
+/* The part of a snapshot in front of the arrays. */
+typedef struct {
+    game_state state;
+    direction dir;
+    int level;
+    int cols, rows;
+    vec2i head_pos, tail_pos, food;
+    int head, len, cap;
+    int vacant_len;
+    uint64_t seed;
+    rng_state rng;
+    uint64_t ticks;
+    uint64_t hash;
+} snapshot_header;
+
+/* The largest ring of a board, see snake_push(). */
+static int snapshot_cap(int ncells) {
+    int cap = 64;
+    while (cap < ncells)
+        cap *= 2;
+    return cap;
+}
+
+/* Followed by the ring of directions (snapshot_cap()/4 bytes), the board and the vacant cells with their positions. */
+size_t game_snapshot_size(int cols, int rows) {
+    size_t ncells = (size_t) cols * rows;
+    return sizeof(snapshot_header) + snapshot_cap(ncells) / 4 + ncells + 2 * ncells * sizeof(int);
+}
+
+void game_snapshot(const game_data *g, void *buf) {
+    const int ncells = g->cols * g->rows;
+
+    snapshot_header h;
+    memset(&h, 0, sizeof(h));
+    h.state = g->state;
+    h.dir = g->dir;
+    h.level = g->level;
+    h.cols = g->cols;
+    h.rows = g->rows;
+    h.head_pos = g->snake.head_pos;
+    h.tail_pos = g->snake.tail_pos;
+    h.food = g->food;
+    h.head = g->snake.head;
+    h.len = g->snake.len;
+    h.cap = g->snake.cap;
+    h.vacant_len = g->vacant.len;
+    h.seed = g->seed;
+    h.rng = g->rng;
+    h.ticks = g->ticks;
+    h.hash = g->hash;
+
+    uint8_t *p = buf;
+    memcpy(p, &h, sizeof(h));
+    p += sizeof(h);
+    memcpy(p, g->snake.dir, g->snake.cap / 4);
+    memset(p + g->snake.cap / 4, 0, (snapshot_cap(ncells) - g->snake.cap) / 4);
+    p += snapshot_cap(ncells) / 4;
+    memcpy(p, g->board, ncells);
+    p += ncells;
+    memcpy(p, g->vacant.cell, g->vacant.len * sizeof(int));
+    memset(p + g->vacant.len * sizeof(int), 0, (ncells - g->vacant.len) * sizeof(int));
+    p += ncells * sizeof(int);
+    memcpy(p, g->vacant.pos, ncells * sizeof(int));
+}
+
+void game_restore(game_data *g, const void *buf) {
+    const uint8_t *p = buf;
+    snapshot_header h;
+    memcpy(&h, p, sizeof(h));
+    p += sizeof(h);
+
+    assert(h.cols == g->cols && h.rows == g->rows);
+    const int ncells = h.cols * h.rows;
+
+    if (g->snake.cap < h.cap)
+        g->snake.dir = realloc(g->snake.dir, h.cap / 4);
+
+    g->state = h.state;
+    g->dir = h.dir;
+    g->level = h.level;
+    g->snake.head_pos = h.head_pos;
+    g->snake.tail_pos = h.tail_pos;
+    g->food = h.food;
+    g->snake.head = h.head;
+    g->snake.len = h.len;
+    g->snake.cap = h.cap;
+    g->vacant.len = h.vacant_len;
+    g->seed = h.seed;
+    g->rng = h.rng;
+    g->ticks = h.ticks;
+    g->hash = h.hash;
+
+    memcpy(g->snake.dir, p, h.cap / 4);
+    p += snapshot_cap(ncells) / 4;
+    memcpy(g->board, p, ncells);
+    p += ncells;
+    memcpy(g->vacant.cell, p, h.vacant_len * sizeof(int));
+    p += ncells * sizeof(int);
+    memcpy(g->vacant.pos, p, ncells * sizeof(int));
+}
+
+void game_free(game_data *g) {
+    free(g->snake.dir);
+    free(g->board);
+    free(g->vacant.cell);
+    free(g->vacant.pos);
+    g->snake.dir = NULL;
+    g->snake.cap = 0;
+    g->board = NULL;
+    g->vacant.cell = NULL;
+    g->vacant.pos = NULL;
+    g->vacant.len_max = 0;
+}
+
+game_data *game_create(int cols, int rows, int level, uint64_t seed) {
+    if (cols < GAME_MIN_SIZE || rows < GAME_MIN_SIZE)
+        return NULL;
+
+    game_data *g = calloc(1, sizeof(game_data));
+    if (g != NULL)
+        game_init(g, cols, rows, level, seed);
+    return g;
+}
+
+void game_destroy(game_data *g) {
+    if (g == NULL)
+        return;
+
+    game_free(g);
+    free(g);
 }
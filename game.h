@@ -1,7 +1,14 @@
 #ifndef SNAKERL_GAME_H
 #define SNAKERL_GAME_H
 
-#include "ui.h"
+/* The rules of the game. This part has no dependency on SDL,
+ * so it can also be built and run headless (see snakerl_core in CMakeLists.txt). */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rng.h"
 
 typedef struct {
     int32_t x, y;
@@ -13,25 +20,164 @@ typedef enum {
 } direction;
 
 typedef enum {
-    INIT = 0, MENU, RUNNING, PAUSE, LOST, QUIT
+    INIT = 0, MENU, RUNNING, PAUSE, LOST, WON, QUIT
 } game_state;
 
+/* Contents of a board cell. */
+typedef enum {
+    EMPTY, SNAKE, WALL, FOOD
+} cell_type;
+
+/* Difficulty levels */
+struct level {
+    const char *desc;
+    unsigned int update_ms;
+    bool wall_collisions;
+};
+
+extern const struct level levels[];
+extern const int nlevels;
+
+/* Rings of directions packed 2 bits each, four to a byte. */
+static inline direction dirs_get(const uint8_t *ring, int i) {
+    return ring[i >> 2] >> (i & 3) * 2 & 3;
+}
+
+static inline void dirs_set(uint8_t *ring, int i, direction dir) {
+    const int shift = (i & 3) * 2;
+    ring[i >> 2] = (ring[i >> 2] & ~(3 << shift)) | dir << shift;
+}
+
+/* One cell in the direction, or against it for a negative sign. */
+static inline vec2i vec2i_step(vec2i v, direction dir, int sign) {
+    v.x += sign * ((dir == RIGHT) - (dir == LEFT));
+    v.y += sign * ((dir == DOWN) - (dir == UP));
+    return v;
+}
+
 typedef struct {
     game_state state;
     direction dir;
     int level;
+    int cols, rows;
+    /* The body is the position of the head and the direction in which the snake moved into each
+     * segment, the position of the tail is kept up to date as it moves. See game_iter to walk it. */
     struct {
+        vec2i head_pos, tail_pos;
+        int head; /* Index of the head segment in the ring. */
         int len;
-        int cap;
-        vec2i *seg;
+        int cap;  /* Always a power of two. */
+        uint8_t *dir; /* Ring of directions, see dirs_get(). */
     } snake;
     vec2i food;
+    uint8_t *board; /* Occupancy grid of cols*rows cells, see cell_type. */
+    struct {
+        int len;
+        int len_max; /* Number of cells the arrays are allocated for. */
+        int *cell; /* Indices of the empty cells, densely packed. */
+        int *pos;  /* Position of each empty cell in the array above. */
+    } vacant;
+    uint64_t seed; /* Replays the current game when passed to game_init() with the same moves. */
+    rng_state rng;
+    uint64_t ticks; /* Ticks played in the current game. */
+    uint64_t hash;  /* See game_hash(), kept up to date by the steps until the game is lost. */
 } game_data;
 
-extern game_data g;
+/* The direction in which the snake entered the i-th segment counting from the head. It left the segment
+ * in the direction of segment i-1, the one for the tail end is that of the segment before. */
+static inline direction game_segment_dir(const game_data *g, int i) {
+    return dirs_get(g->snake.dir, (g->snake.head + i) & (g->snake.cap - 1));
+}
+
+/* Moves v back into the board after a transition to the opposite wall. */
+static inline vec2i game_wrap(const game_data *g, vec2i v) {
+    if (v.x < 0) v.x += g->cols;
+    else if (v.x >= g->cols) v.x -= g->cols;
+    if (v.y < 0) v.y += g->rows;
+    else if (v.y >= g->rows) v.y -= g->rows;
+    return v;
+}
+
+/* Walks the segments from the head to the tail:
+ *     for (game_iter it = game_iter_begin(g); it.i < g->snake.len; game_iter_next(g, &it))
+ *         ... it.pos is the position of the it.i-th segment ... */
+typedef struct {
+    int i;
+    vec2i pos;
+} game_iter;
+
+static inline game_iter game_iter_begin(const game_data *g) {
+    return (game_iter) { 0, g->snake.head_pos };
+}
+
+static inline void game_iter_next(const game_data *g, game_iter *it) {
+    it->pos = game_wrap(g, vec2i_step(it->pos, game_segment_dir(g, it->i), -1));
+    it->i++;
+}
+
+/* The smallest number of columns and rows of a board. The snake starts in the middle half of the board
+ * with its tail one cell behind the head, which needs 4 cells each way to stay on the board. */
+#define GAME_MIN_SIZE 4
+
+/* Games keep no global state, any number of instances can be played at once.
+ * An instance only needs to be confined to one thread at a time.
+ * Returns NULL if the board is smaller than GAME_MIN_SIZE either way or out of memory. */
+game_data *game_create(int cols, int rows, int level, uint64_t seed);
+void game_destroy(game_data *g);
+
+/* Starts a new game with the same board size and level. Its seed is drawn from the previous game's generator. */
+void game_reset(game_data *g);
+
+/* Starts a new game on a cols x rows board in place, both at least GAME_MIN_SIZE. The game data must be
+ * zeroed before the first call, the memory is reused by the subsequent calls and released with game_free(). */
+void game_init(game_data *g, int cols, int rows, int level, uint64_t seed);
+void game_free(game_data *g);
+
+/* Zobrist hash of the position: the direction, the food and the cells of the body, the head apart and
+ * every other segment by the direction in which the snake left it. Equal positions have equal hashes
+ * whatever the moves that led to them. The generator is left out, it only decides where food comes next.
+ * Computed from scratch here, game_data.hash has the same value. */
+uint64_t game_hash(const game_data *g);
+
+/* Returns true if the direction was changed. Reversing the direction is not allowed. */
+bool game_setdirection(game_data *g, direction newdir);
+
+/* Turns the snake towards action (if it is not DIRECTION_NOVALUE)
+ * and advances a RUNNING game by one tick. Returns the resulting state. */
+game_state game_step(game_data *g, direction action);
+
+/* Snapshots hold the complete state of a game in a flat buffer of game_snapshot_size() bytes,
+ * which only depends on the board size. Taking and restoring one never allocates,
+ * except that the body of the restored game grows once if it is shorter than the snapshot's. */
+size_t game_snapshot_size(int cols, int rows);
+void game_snapshot(const game_data *g, void *buf);
+/* The game must have been started on a board of the same size. */
+void game_restore(game_data *g, const void *buf);
+
+/* A step records the cells it changes (see game_step_record()), at most 4 board cells
+ * with their vacant entries and 2 bytes of the body. */
+#define GAME_UNDO_MAX_WRITES 24
+
+typedef struct {
+    struct {
+        uint8_t what;
+        int32_t index, old;
+    } write[GAME_UNDO_MAX_WRITES];
+    int nwrites;
+
+    /* Fields of game_data before the step. */
+    game_state state;
+    direction dir;
+    vec2i head_pos, tail_pos, food;
+    int head, len, cap;
+    int vacant_len;
+    rng_state rng;
+    uint64_t ticks;
+    uint64_t hash;
+} game_undo;
 
-void game_setdirection(direction newdir);
-void game_run(void (*eventpoll)(void), void (*present)(void));
-void game_quit(void);
+/* Same as game_step(), keeping what game_undo_step() needs to revert the step. */
+game_state game_step_record(game_data *g, direction action, game_undo *undo);
+void game_undo_step(game_data *g, const game_undo *undo);
 
 #endif
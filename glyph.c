@@ -0,0 +1,157 @@
+#include <stdlib.h>
+
+#include "glyph.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define GLYPH_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GLYPH_NEON
+#include <arm_neon.h>
+#endif
+
+static inline uint32_t *next_row(uint32_t *pixels, int pitch) {
+    return (uint32_t *) ((uint8_t *) pixels + pitch);
+}
+
+/* Expands pixels x..w-1 of a row. */
+static inline void expand_scalar(unsigned bits, int x, int w, uint32_t fg, uint32_t bg, uint32_t *pixels) {
+    for (; x < w; x++) {
+        uint32_t mask = -(uint32_t) (bits >> x & 1);
+        pixels[x] = (fg & mask) | (bg & ~mask);
+    }
+}
+
+static void glyph_draw_scalar(const uint16_t *rows, int w, int h, uint32_t fg, uint32_t bg, uint32_t *pixels, int pitch) {
+    for (int y = 0; y < h; y++, pixels = next_row(pixels, pitch))
+        expand_scalar(rows[y], 0, w, fg, bg, pixels);
+}
+
+/* The SIMD kernels test one bit of the row per lane, four or eight pixels at a time,
+ * which covers the usual widths of 8, 11 and 16 pixels with at most three left over. */
+
+#ifdef GLYPH_X86
+
+__attribute__((target("sse2")))
+static void glyph_draw_sse2(const uint16_t *rows, int w, int h, uint32_t fg, uint32_t bg, uint32_t *pixels, int pitch) {
+    const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128i fgv = _mm_set1_epi32(fg), bgv = _mm_set1_epi32(bg);
+
+    for (int y = 0; y < h; y++, pixels = next_row(pixels, pitch)) {
+        int x = 0;
+        for (; x + 4 <= w; x += 4) {
+            __m128i m = _mm_and_si128(_mm_set1_epi32(rows[y] >> x), lanes);
+            m = _mm_cmpeq_epi32(m, lanes);
+            _mm_storeu_si128((__m128i *) (pixels + x), _mm_or_si128(_mm_and_si128(m, fgv), _mm_andnot_si128(m, bgv)));
+        }
+        expand_scalar(rows[y], x, w, fg, bg, pixels);
+    }
+}
+
+__attribute__((target("avx2")))
+static void glyph_draw_avx2(const uint16_t *rows, int w, int h, uint32_t fg, uint32_t bg, uint32_t *pixels, int pitch) {
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i fgv = _mm256_set1_epi32(fg), bgv = _mm256_set1_epi32(bg);
+
+    /* The pixels past the last group of eight are written with a mask. */
+    const int full = w & ~7;
+    const __m256i tail = _mm256_cmpgt_epi32(_mm256_set1_epi32(w - full), index);
+
+    for (int y = 0; y < h; y++, pixels = next_row(pixels, pitch)) {
+        int x = 0;
+        for (; x < full; x += 8) {
+            __m256i m = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(rows[y] >> x), lanes), lanes);
+            _mm256_storeu_si256((__m256i *) (pixels + x), _mm256_blendv_epi8(bgv, fgv, m));
+        }
+        if (x < w) {
+            __m256i m = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(rows[y] >> x), lanes), lanes);
+            _mm256_maskstore_epi32((int *) (pixels + x), tail, _mm256_blendv_epi8(bgv, fgv, m));
+        }
+    }
+}
+
+#endif
+
+#ifdef GLYPH_NEON
+
+static void glyph_draw_neon(const uint16_t *rows, int w, int h, uint32_t fg, uint32_t bg, uint32_t *pixels, int pitch) {
+    static const uint32_t lane_bits[4] = { 1, 2, 4, 8 };
+    const uint32x4_t lanes = vld1q_u32(lane_bits);
+    const uint32x4_t fgv = vdupq_n_u32(fg), bgv = vdupq_n_u32(bg);
+
+    for (int y = 0; y < h; y++, pixels = next_row(pixels, pitch)) {
+        int x = 0;
+        for (; x + 4 <= w; x += 4) {
+            uint32x4_t m = vtstq_u32(vdupq_n_u32(rows[y] >> x), lanes);
+            vst1q_u32(pixels + x, vbslq_u32(m, fgv, bgv));
+        }
+        expand_scalar(rows[y], x, w, fg, bg, pixels);
+    }
+}
+
+#endif
+
+bool glyph_setkernel(glyph_font *font, glyph_kernel kernel) {
+#ifdef GLYPH_X86
+    __builtin_cpu_init();
+    bool has_avx2 = __builtin_cpu_supports("avx2");
+    bool has_sse2 = __builtin_cpu_supports("sse2");
+#endif
+
+    glyph_draw_fn draw = NULL;
+    switch (kernel) {
+    case GLYPH_KERNEL_AUTO:
+#if defined(GLYPH_X86)
+        draw = has_avx2 ? glyph_draw_avx2 : has_sse2 ? glyph_draw_sse2 : glyph_draw_scalar;
+#elif defined(GLYPH_NEON)
+        draw = glyph_draw_neon;
+#else
+        draw = glyph_draw_scalar;
+#endif
+        break;
+    case GLYPH_KERNEL_SCALAR:
+        draw = glyph_draw_scalar;
+        break;
+#ifdef GLYPH_X86
+    case GLYPH_KERNEL_SSE2:
+        draw = has_sse2 ? glyph_draw_sse2 : NULL;
+        break;
+    case GLYPH_KERNEL_AVX2:
+        draw = has_avx2 ? glyph_draw_avx2 : NULL;
+        break;
+#endif
+#ifdef GLYPH_NEON
+    case GLYPH_KERNEL_NEON:
+        draw = glyph_draw_neon;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    if (draw == NULL)
+        return false;
+
+    font->draw = draw;
+    return true;
+}
+
+bool glyph_font_init(glyph_font *font, int w, int h) {
+    if (w < 1 || w > GLYPH_MAX_W || h < 1)
+        return false;
+
+    font->rows = calloc(256 * h, sizeof(uint16_t));
+    if (font->rows == NULL)
+        return false;
+
+    font->w = w;
+    font->h = h;
+    glyph_setkernel(font, GLYPH_KERNEL_AUTO);
+    return true;
+}
+
+void glyph_font_free(glyph_font *font) {
+    free(font->rows);
+    font->rows = NULL;
+}
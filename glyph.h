@@ -0,0 +1,43 @@
+#ifndef SNAKERL_GLYPH_H
+#define SNAKERL_GLYPH_H
+
+/* Fonts packed one bit per pixel, expanded straight into 32-bit pixels.
+ * No SDL dependency, the caller passes the colors already mapped to the surface format. */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Widest glyph that fits a packed row. */
+#define GLYPH_MAX_W 16
+
+typedef enum {
+    GLYPH_KERNEL_AUTO, GLYPH_KERNEL_SCALAR, GLYPH_KERNEL_SSE2, GLYPH_KERNEL_AVX2, GLYPH_KERNEL_NEON
+} glyph_kernel;
+
+/* Expands the h rows of a glyph, w pixels each, bit x of a row set means the foreground. */
+typedef void (*glyph_draw_fn)(const uint16_t *rows, int w, int h, uint32_t fg, uint32_t bg, uint32_t *pixels, int pitch);
+
+typedef struct {
+    int w, h;
+    uint16_t *rows; /* h rows for each of the 256 glyphs, bit x is the pixel x of the row. */
+    glyph_draw_fn draw;
+} glyph_font;
+
+/* Allocates an empty font of 256 glyphs and selects the fastest kernel supported by the CPU.
+ * Returns false if the glyphs are wider than GLYPH_MAX_W or the allocation fails. */
+bool glyph_font_init(glyph_font *font, int w, int h);
+void glyph_font_free(glyph_font *font);
+
+/* Selects a specific kernel. Returns false if the CPU does not support it. */
+bool glyph_setkernel(glyph_font *font, glyph_kernel kernel);
+
+static inline void glyph_setpixel(glyph_font *font, unsigned char c, int x, int y) {
+    font->rows[c*font->h + y] |= 1u << x;
+}
+
+/* Draws the glyph with its top left corner at pixels, which has the given pitch in bytes. */
+static inline void glyph_draw(const glyph_font *font, unsigned char c, uint32_t fg, uint32_t bg, void *pixels, int pitch) {
+    font->draw(font->rows + c*font->h, font->w, font->h, fg, bg, (uint32_t *) pixels, pitch);
+}
+
+#endif
@@ -7,7 +7,7 @@
 
 #include "SDL_syswm.h"
 #include "const.h"
-#include "game.h"
+#include "session.h"
 #include "ui.h"
 
 @import GoogleMobileAds;
@@ -119,7 +119,8 @@ int app_handle_events(void *userdata, SDL_Event *event) {
 
             if (g.state == RUNNING)
                 g.state = PAUSE;
-            return 0;
+            /* Keep the event, so that the game loop wakes up and shows the pause. */
+            return 1;
         case SDL_APP_DIDENTERBACKGROUND:
             /* This will get called if the user accepted whatever sent your app to the background.
              * If the user got a phone call and canceled it, you'll instead get an SDL_APP_DIDENTERFOREGROUND event and restart your loops.
@@ -143,14 +144,22 @@ int app_handle_events(void *userdata, SDL_Event *event) {
     }
 }
 
-void eventpoll() {
+bool eventpoll() {
     direction newdir = DIRECTION_NOVALUE;
     int touch_winx, touch_winy;
+    bool redraw = false;
 
     SDL_Event e;
     while (SDL_PollEvent(&e)) {
         switch (e.type) {
+            case SDL_WINDOWEVENT:
+                if (e.window.event == SDL_WINDOWEVENT_EXPOSED) {
+                    ui_invalidate();
+                    redraw = true;
+                }
+                break;
             case SDL_FINGERDOWN:
+                redraw = true;
                 touch_winx = e.tfinger.x * ui_surface->w;
                 touch_winy = e.tfinger.y * ui_surface->h;
 
@@ -165,6 +174,7 @@ void eventpoll() {
                             g.state = RUNNING;
                             break;
                         case LOST:
+                        case WON:
                             g.state = INIT;
                             break;
                         default:
@@ -195,8 +205,10 @@ void eventpoll() {
 
     /* Update the direction only once per eventpoll. */
     if (newdir != DIRECTION_NOVALUE && g.state == RUNNING) {
-        game_setdirection(newdir);
+        game_turn(newdir);
     }
+
+    return redraw;
 }
 
 void draw(void) {
@@ -222,12 +234,16 @@ void draw(void) {
 
         /* Draw the snake. The symbol selection algorithm chooses appropriate symbol for turns,
          * see snake_segment_symbol(int). */
-        for (int i = g.snake.len-1; i >= 0; i--) {
-            ui_putch(g.snake.seg[i].x, g.snake.seg[i].y, segment_symbol(i));
-        }
+        game_iter it = game_iter_begin(&g);
+        for (game_iter_next(&g, &it); it.i < g.snake.len; game_iter_next(&g, &it))
+            ui_putch(it.pos.x, it.pos.y, segment_symbol(&g, it.i));
 
-        /* Display food. */
-        ui_putch(g.food.x, g.food.y, food_symbol);
+        /* The head goes last, on top of the segment it has run into. */
+        ui_putch(g.snake.head_pos.x, g.snake.head_pos.y, segment_symbol(&g, 0));
+
+        /* Display food. There is none left once the board is filled. */
+        if (g.state != WON)
+            ui_putch(g.food.x, g.food.y, food_symbol);
 
         /* Simple flag to show the ad only once after player loses. */
         static bool ad_shown;
@@ -247,7 +263,10 @@ void draw(void) {
             ui_putstr(ui_cols/2-ARR_SIZE(lost_str)/2, ui_rows/2, lost_str);
         } else ad_shown = false;
 
-        if (g.state == PAUSE) {
+        if (g.state == WON) {
+            ui_setfg(color_message);
+            ui_putstr(ui_cols/2-ARR_SIZE(won_str)/2, ui_rows/2, won_str);
+        } else if (g.state == PAUSE) {
             ui_setfg(color_message);
             ui_putstr(ui_cols/2-ARR_SIZE(pause_str)/2, ui_rows/2, pause_str);
         }
@@ -255,16 +274,17 @@ void draw(void) {
 
     switch (g.state) {
         case MENU:
-            SDL_BlitSurface(arrow_tex, NULL, ui_surface, &button_rect);
+            ui_blit(arrow_tex, &button_rect);
             break;
         case RUNNING:
-            SDL_BlitSurface(pause_tex, NULL, ui_surface, &button_rect);
+            ui_blit(pause_tex, &button_rect);
             break;
         case PAUSE:
-            SDL_BlitSurface(continue_tex, NULL, ui_surface, &button_rect);
+            ui_blit(continue_tex, &button_rect);
             break;
         case LOST:
-            SDL_BlitSurface(retry_tex, NULL, ui_surface, &button_rect);
+        case WON:
+            ui_blit(retry_tex, &button_rect);
             break;
         default: break;
     }
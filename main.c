@@ -1,18 +1,28 @@
 #include <SDL2/SDL.h>
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
 
-#include "game.h"
+#include "session.h"
 #include "const.h"
 
-void eventpoll() {
+bool eventpoll() {
     direction newdir = DIRECTION_NOVALUE;
+    bool redraw = false;
 
     SDL_Event e;
     while (SDL_PollEvent(&e)) {
         switch (e.type) {
 
+        case SDL_WINDOWEVENT:
+            if (e.window.event == SDL_WINDOWEVENT_EXPOSED) {
+                ui_invalidate();
+                redraw = true;
+            }
+            break;
+
         case SDL_KEYUP:
+            redraw = true;
             switch (e.key.keysym.sym) {
 
             case SDLK_q:
@@ -25,7 +35,7 @@ void eventpoll() {
             case SDLK_RETURN:
                 if (g.state == MENU) {
                     g.state = RUNNING;
-                } else if (g.state == LOST) {
+                } else if (g.state == LOST || g.state == WON) {
                     g.state = INIT;
                 }
 
@@ -46,6 +56,7 @@ void eventpoll() {
 
             break;
         case SDL_KEYDOWN:
+            redraw = true;
             switch (e.key.keysym.sym) {
 
             case SDLK_k:
@@ -84,8 +95,10 @@ void eventpoll() {
     /* Update the direction only once per eventpoll. */
     if (newdir != DIRECTION_NOVALUE && (g.state == RUNNING || g.state == PAUSE)) {
         g.state = RUNNING;
-        game_setdirection(newdir);
+        game_turn(newdir);
     }
+
+    return redraw;
 }
 
 void draw(void) {
@@ -112,17 +125,24 @@ void draw(void) {
 
         /* Draw the snake. The symbol selection algorithm chooses appropriate symbol for turns,
          * see segment_symbol(int) in const.c. */
-        for (int i = g.snake.len-1; i >= 0; i--) {
-            ui_putch(g.snake.seg[i].x, g.snake.seg[i].y, segment_symbol(i));
-        }
+        game_iter it = game_iter_begin(&g);
+        for (game_iter_next(&g, &it); it.i < g.snake.len; game_iter_next(&g, &it))
+            ui_putch(it.pos.x, it.pos.y, segment_symbol(&g, it.i));
+
+        /* The head goes last, on top of the segment it has run into. */
+        ui_putch(g.snake.head_pos.x, g.snake.head_pos.y, segment_symbol(&g, 0));
 
-        /* Display food. */
-        ui_putch(g.food.x, g.food.y, food_symbol);
+        /* Display food. There is none left once the board is filled. */
+        if (g.state != WON)
+            ui_putch(g.food.x, g.food.y, food_symbol);
 
         /* Draw game over and pause messages on top, keeping the snake as the background. */
         if (g.state == LOST) {
             ui_setfg(color_message);
             ui_putstr(ui_cols/2-ARR_SIZE(lost_str)/2, ui_rows/2, lost_str);
+        } else if (g.state == WON) {
+            ui_setfg(color_message);
+            ui_putstr(ui_cols/2-ARR_SIZE(won_str)/2, ui_rows/2, won_str);
         } else if (g.state == PAUSE) {
             ui_setfg(color_message);
             ui_putstr(ui_cols/2-ARR_SIZE(pause_str)/2, ui_rows/2, pause_str);
@@ -139,7 +159,14 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
-    const char *font = argc > 1 ? argv[1] : default_font;
+    /* snakerl [--autopilot] [font] */
+    const char *font = default_font;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--autopilot") == 0) {
+            if (!game_setautopilot(true))
+                SDL_Log("Unable to start the autopilot");
+        } else font = argv[i];
+    }
 
     if (!ui_init(title, font, UI_COLS, UI_ROWS))
         return 1;
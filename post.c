@@ -0,0 +1,178 @@
+#include <stdbool.h>
+
+#include "post.h"
+
+/* Areas smaller than this are processed on the calling thread, waking the workers costs more. */
+#define POST_MIN_PARALLEL_PIXELS (128*128)
+
+/* Bands are at least this many rows high, and there are about this many bands per thread,
+ * so that a thread finishing early can pick up some more work. */
+#define POST_MIN_BAND_ROWS 8
+#define POST_BANDS_PER_THREAD 4
+
+#define POST_MAX_THREADS 16
+
+static struct {
+    SDL_Thread *threads[POST_MAX_THREADS];
+    int nthreads;
+
+    /* Everything below is guarded by the lock. */
+    SDL_mutex *lock;
+    SDL_cond *start, *done;
+    bool quit;
+
+    /* The pass being run. */
+    const post_pass *pass;
+    SDL_Surface *surface;
+    SDL_Rect *bands;
+    int nbands, bands_cap;
+    int next;      /* The next band to be taken. */
+    int remaining; /* Bands not finished yet. */
+} post;
+
+/* Takes bands of the current pass until there are none left. Called with the lock held. */
+static void post_work(void) {
+    while (post.next < post.nbands) {
+        const post_pass *pass = post.pass;
+        SDL_Surface *surface = post.surface;
+        SDL_Rect band = post.bands[post.next++];
+
+        SDL_UnlockMutex(post.lock);
+        pass->fn(surface, &band, pass->userdata);
+        SDL_LockMutex(post.lock);
+
+        if (--post.remaining == 0)
+            SDL_CondSignal(post.done);
+    }
+}
+
+static int post_worker(void *unused) {
+    (void) unused;
+
+    SDL_LockMutex(post.lock);
+    while (!post.quit) {
+        post_work();
+        if (!post.quit)
+            SDL_CondWait(post.start, post.lock);
+    }
+    SDL_UnlockMutex(post.lock);
+
+    return 0;
+}
+
+int post_init(void) {
+    post.lock = SDL_CreateMutex();
+    post.start = SDL_CreateCond();
+    post.done = SDL_CreateCond();
+    if (post.lock == NULL || post.start == NULL || post.done == NULL) {
+        SDL_Log("Unable to create post-processing pool: %s", SDL_GetError());
+        post_quit();
+        return 0;
+    }
+
+    /* The calling thread takes part as well. */
+    int nthreads = SDL_GetCPUCount() - 1;
+    if (nthreads > POST_MAX_THREADS)
+        nthreads = POST_MAX_THREADS;
+
+    for (int i = 0; i < nthreads; i++) {
+        post.threads[post.nthreads] = SDL_CreateThread(post_worker, "post", NULL);
+        if (post.threads[post.nthreads] == NULL) {
+            SDL_Log("Unable to create post-processing thread: %s", SDL_GetError());
+            break;
+        }
+        post.nthreads++;
+    }
+
+    return 1;
+}
+
+void post_quit(void) {
+    if (post.lock != NULL) {
+        SDL_LockMutex(post.lock);
+        post.quit = true;
+        SDL_CondBroadcast(post.start);
+        SDL_UnlockMutex(post.lock);
+    }
+
+    for (int i = 0; i < post.nthreads; i++)
+        SDL_WaitThread(post.threads[i], NULL);
+    post.nthreads = 0;
+
+    SDL_DestroyCond(post.done);
+    SDL_DestroyCond(post.start);
+    SDL_DestroyMutex(post.lock);
+    SDL_free(post.bands);
+    post.done = post.start = NULL;
+    post.lock = NULL;
+    post.bands = NULL;
+    post.bands_cap = 0;
+}
+
+/* Splits the areas into bands of about the same number of rows. Called with the lock held,
+ * returns false on allocation failure. */
+static bool post_split(const SDL_Rect *rects, int nrects) {
+    int rows = 0;
+    for (int i = 0; i < nrects; i++)
+        rows += rects[i].h;
+
+    int band_rows = rows / ((post.nthreads + 1) * POST_BANDS_PER_THREAD);
+    if (band_rows < POST_MIN_BAND_ROWS)
+        band_rows = POST_MIN_BAND_ROWS;
+
+    post.nbands = post.next = 0;
+    for (int i = 0; i < nrects; i++) {
+        for (int y = 0; y < rects[i].h; y += band_rows) {
+            if (post.nbands == post.bands_cap) {
+                int cap = post.bands_cap == 0 ? 64 : post.bands_cap * 2;
+                SDL_Rect *bands = SDL_realloc(post.bands, cap * sizeof(SDL_Rect));
+                if (bands == NULL)
+                    return false;
+                post.bands = bands;
+                post.bands_cap = cap;
+            }
+
+            int h = rects[i].h - y < band_rows ? rects[i].h - y : band_rows;
+            post.bands[post.nbands++] = (SDL_Rect) { rects[i].x, rects[i].y + y, rects[i].w, h };
+        }
+    }
+
+    return true;
+}
+
+void post_run(SDL_Surface *surface, const post_pass *passes, int npasses, const SDL_Rect *rects, int nrects) {
+    int pixels = 0;
+    for (int i = 0; i < nrects; i++)
+        pixels += rects[i].w * rects[i].h;
+
+    SDL_LockSurface(surface);
+
+    bool parallel = false;
+    if (post.nthreads > 0 && pixels >= POST_MIN_PARALLEL_PIXELS) {
+        /* The workers look at the bands while idle, so they are only changed under the lock. */
+        SDL_LockMutex(post.lock);
+        parallel = post_split(rects, nrects);
+
+        for (int p = 0; parallel && p < npasses; p++) {
+            post.pass = &passes[p];
+            post.surface = surface;
+            post.next = 0;
+            post.remaining = post.nbands;
+            SDL_CondBroadcast(post.start);
+
+            /* Work along, then wait for the bands still being processed by the workers. */
+            post_work();
+            while (post.remaining > 0)
+                SDL_CondWait(post.done, post.lock);
+        }
+        SDL_UnlockMutex(post.lock);
+    }
+
+    if (!parallel) {
+        for (int p = 0; p < npasses; p++)
+            for (int i = 0; i < nrects; i++)
+                passes[p].fn(surface, &rects[i], passes[p].userdata);
+    }
+
+    SDL_UnlockSurface(surface);
+}
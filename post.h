@@ -0,0 +1,29 @@
+#ifndef SNAKERL_POST_H
+#define SNAKERL_POST_H
+
+/* Post-processing pipeline: a list of passes over areas of a surface. Each pass is split into
+ * horizontal bands that run in parallel on a persistent pool of worker threads,
+ * every pass finishes on the whole area before the next one starts. */
+
+#ifdef TARGET_IOS
+#include "SDL.h"
+#else
+#include <SDL2/SDL.h>
+#endif
+
+/* Processes one band of the surface. Called concurrently for different bands,
+ * the surface is already locked. */
+typedef void (*post_fn)(SDL_Surface *surface, const SDL_Rect *band, void *userdata);
+
+typedef struct {
+    post_fn fn;
+    void *userdata;
+} post_pass;
+
+int post_init(void);
+void post_quit(void);
+
+/* Runs the passes in order over the given areas of the surface. */
+void post_run(SDL_Surface *surface, const post_pass *passes, int npasses, const SDL_Rect *rects, int nrects);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef SNAKERL_RNG_H
+#define SNAKERL_RNG_H
+
+/* Random numbers for the game rules. The state lives with each game,
+ * so games never share a generator and a seed always reproduces the same game. */
+
+#include <stdint.h>
+
+typedef uint64_t rng_state;
+
+/* PCG32 (XSH RR) with a fixed increment: a 64-bit LCG with a permuted 32-bit output. */
+static inline uint32_t rng_next(rng_state *s) {
+    uint64_t old = *s;
+    *s = old * 6364136223846793005ULL + 1442695040888963407ULL;
+    uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+    uint32_t rot = old >> 59;
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+static inline uint64_t rng_next64(rng_state *s) {
+    uint64_t hi = rng_next(s);
+    return (hi << 32) | rng_next(s);
+}
+
+/* A number in [0, n), scaled with a multiplication instead of a division. */
+static inline uint32_t rng_below(rng_state *s, uint32_t n) {
+    return ((uint64_t) rng_next(s) * n) >> 32;
+}
+
+static inline void rng_init(rng_state *s, uint64_t seed) {
+    *s = 0;
+    rng_next(s);
+    *s += seed;
+    rng_next(s);
+}
+
+/* Derives the seed of the n-th game from a common seed (SplitMix64),
+ * so neighbouring games do not get correlated sequences. */
+static inline uint64_t rng_seed(uint64_t seed, uint64_t n) {
+    uint64_t z = seed + (n + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+#endif
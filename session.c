@@ -0,0 +1,156 @@
+#include <time.h>
+
+#include "session.h"
+#include "const.h"
+#include "ai.h"
+
+/* The g.state is INIT by default. */
+game_data g = { 0 };
+
+static bool force_update = false;
+
+/* Search memory of the autopilot, NULL when the player steers. */
+static ai_pilot *pilot = NULL;
+
+/* The end of a game stays on the screen this long before the autopilot starts the next one. */
+#define AUTOPILOT_RESTART_MS 2000
+
+void game_turn(direction newdir) {
+    /* Turning makes the snake move immediately. */
+    if (game_setdirection(&g, newdir))
+        force_update = true;
+}
+
+void game_quit(void) {
+    g.state = QUIT;
+    game_free(&g);
+    game_setautopilot(false);
+}
+
+bool game_setautopilot(bool enabled) {
+    if (!enabled) {
+        ai_pilot_destroy(pilot);
+        pilot = NULL;
+    } else if (pilot == NULL) {
+        pilot = ai_pilot_create();
+    }
+
+    return (pilot != NULL) == enabled;
+}
+
+/* After a stall the snake catches up by at most this many ticks, the rest of the lag is dropped. */
+#define MAX_CATCHUP_TICKS 4
+
+/* Converts performance counter units to milliseconds, rounding up so that a wait never ends early. */
+static int counts_to_ms(uint64_t counts, uint64_t freq) {
+    return (counts * 1000 + freq - 1) / freq;
+}
+
+void game_run(bool (*eventpoll)(void), void (*draw)(void)) {
+    const uint64_t freq = SDL_GetPerformanceFrequency();
+
+    /* Frames are presented at most at the display refresh rate. */
+    SDL_DisplayMode mode;
+    int refresh_rate = 60;
+    if (SDL_GetWindowDisplayMode(ui_window, &mode) == 0 && mode.refresh_rate > 0)
+        refresh_rate = mode.refresh_rate;
+    const uint64_t frame = freq / refresh_rate;
+
+    uint64_t now = SDL_GetPerformanceCounter();
+    uint64_t last = now, last_frame = now - frame;
+    uint64_t accumulator = 0; /* Time not yet simulated, in performance counter units. */
+    uint64_t ended = now;     /* When the last game was lost or won. */
+    game_state last_state = g.state;
+    bool redraw = true;
+
+    while (g.state != QUIT) {
+        if (g.state == INIT) {
+            /* Only the first game is seeded from the clock, the next ones continue from it. */
+            if (g.board == NULL)
+                game_init(&g, ui_cols, ui_rows, g.level, time(NULL));
+            else game_reset(&g);
+            SDL_Log("Game seed: %llu", (unsigned long long) g.seed);
+            g.state = pilot != NULL ? RUNNING : MENU;
+            continue;
+        }
+
+        const uint64_t tick = freq * levels[g.level].update_ms / 1000;
+
+        /* Sleep until an event arrives, the next tick is due or a postponed frame can be presented.
+         * Nothing changes in the other states until the player does something,
+         * so those wait for the next event without a timeout. */
+        int timeout = -1;
+        if (g.state == RUNNING)
+            timeout = accumulator >= tick ? 0 : counts_to_ms(tick - accumulator, freq);
+        else if (pilot != NULL && (g.state == LOST || g.state == WON)) {
+            const uint64_t restart = freq * AUTOPILOT_RESTART_MS / 1000;
+            if (now - ended >= restart) {
+                g.state = INIT;
+                continue;
+            }
+            timeout = counts_to_ms(restart - (now - ended), freq);
+        }
+        if (redraw && now - last_frame < frame) {
+            int frame_timeout = counts_to_ms(frame - (now - last_frame), freq);
+            if (timeout < 0 || frame_timeout < timeout)
+                timeout = frame_timeout;
+        }
+
+        const game_state waited = g.state;
+        bool pending = timeout < 0 ? SDL_WaitEvent(NULL) : SDL_WaitEventTimeout(NULL, timeout);
+        if (pending && eventpoll())
+            redraw = true;
+
+        if (g.state == MENU) {
+            if ((signed int) g.level > nlevels-1)
+                g.level = 0;
+            else if ((signed int) g.level < 0)
+                g.level = nlevels-1;
+        }
+
+        now = SDL_GetPerformanceCounter();
+        if (g.state == RUNNING) {
+            /* Only the time the game was running counts. The wait in the menu or paused has no
+             * timeout, leaving either would otherwise catch up on all of it in one burst of ticks. */
+            if (waited == RUNNING)
+                accumulator += now - last;
+            if (force_update) {
+                /* Turning moves the snake right away and restarts the tick. */
+                force_update = false;
+                accumulator = 0;
+                game_step(&g, DIRECTION_NOVALUE);
+                redraw = true;
+            }
+
+            for (int n = 0; accumulator >= tick && g.state == RUNNING; n++) {
+                if (n == MAX_CATCHUP_TICKS) {
+                    accumulator = 0;
+                    break;
+                }
+
+                accumulator -= tick;
+                game_step(&g, pilot != NULL ? ai_autopilot(&g, pilot) : DIRECTION_NOVALUE);
+                redraw = true;
+            }
+        } else {
+            /* Time spent in the menu or paused is not simulated. */
+            accumulator = 0;
+        }
+        last = now;
+
+        if (g.state != last_state) {
+            last_state = g.state;
+            if (g.state == LOST || g.state == WON)
+                ended = now;
+            redraw = true;
+        }
+
+        if (redraw && now - last_frame >= frame) {
+            draw();
+            last_frame = now;
+            redraw = false;
+        }
+    }
+
+    game_quit();
+}
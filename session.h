@@ -0,0 +1,22 @@
+#ifndef SNAKERL_SESSION_H
+#define SNAKERL_SESSION_H
+
+/* The interactive game session shared by the frontends: owns the game being played
+ * and drives it in real time from the SDL event loop. */
+
+#include "game.h"
+#include "ui.h"
+
+extern game_data g;
+
+void game_turn(direction newdir);
+/* Runs the game until it is quit. eventpoll handles all pending events and returns true
+ * if the screen has to be redrawn (the input was handled or the window was exposed). */
+void game_run(bool (*eventpoll)(void), void (*draw)(void));
+void game_quit(void);
+
+/* Lets the game play itself, for demos: the snake is steered by ai_autopilot()
+ * and the games start and restart on their own. Returns false if it can not be enabled. */
+bool game_setautopilot(bool enabled);
+
+#endif
@@ -0,0 +1,317 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+/* Ranges are halved down to this many games, smaller ones are played without splitting. */
+#define SIM_GRAIN 4
+
+/* Halving a range of at most LONG_MAX games never needs more entries than this. */
+#define SIM_DEQUE_CAP 64
+
+typedef struct {
+    long first, count;
+} sim_range;
+
+typedef struct {
+    pthread_mutex_t lock;
+    sim_range items[SIM_DEQUE_CAP];
+    int top, bottom; /* Thieves take from the top, the owner works at the bottom. */
+} sim_deque;
+
+typedef struct {
+    sim_pool *pool;
+    pthread_t thread;
+    int index;
+    sim_deque deque;
+    sim_result result;
+    game_data game;
+    rng_state victim_rng;
+} sim_worker;
+
+struct sim_pool {
+    sim_config config;
+    int nthreads;
+    sim_worker *workers;
+    sim_result *results;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start, finish;
+    pthread_cond_t work;      /* Signalled when ranges are shared and when the run is done. */
+    unsigned long shared;     /* Incremented whenever a worker has shared ranges, guarded by lock. */
+    unsigned long generation; /* Incremented for every run. */
+    int busy;                 /* Workers that have not finished the current run. */
+    bool quit;
+
+    /* The current run. */
+    game_policy policy;
+    void *userdata;
+    long remaining; /* Games not played yet, guarded by lock. */
+};
+
+static void deque_push(sim_deque *d, sim_range r) {
+    pthread_mutex_lock(&d->lock);
+    /* Compact the deque when the bottom reaches the end. */
+    if (d->bottom == SIM_DEQUE_CAP) {
+        memmove(d->items, d->items + d->top, (d->bottom - d->top) * sizeof(sim_range));
+        d->bottom -= d->top;
+        d->top = 0;
+    }
+    d->items[d->bottom++] = r;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static bool deque_pop(sim_deque *d, sim_range *r) {
+    bool ok = false;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top) {
+        *r = d->items[--d->bottom];
+        ok = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+static bool deque_steal(sim_deque *d, sim_range *r) {
+    bool ok = false;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top) {
+        *r = d->items[d->top++];
+        ok = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+static bool sim_steal(sim_worker *w, sim_range *r) {
+    sim_pool *p = w->pool;
+    int start = rng_below(&w->victim_rng, p->nthreads);
+    for (int i = 0; i < p->nthreads; i++) {
+        int victim = (start + i) % p->nthreads;
+        if (victim != w->index && deque_steal(&p->workers[victim].deque, r))
+            return true;
+    }
+    return false;
+}
+
+static void sim_play(sim_worker *w, long n) {
+    sim_pool *p = w->pool;
+    game_data *g = &w->game;
+
+    game_init(g, p->config.cols, p->config.rows, p->config.level, rng_seed(p->config.seed, n));
+
+    long ticks = 0;
+    while (g->state == RUNNING && (p->config.max_ticks == 0 || ticks < p->config.max_ticks)) {
+        game_step(g, p->policy(g, p->userdata));
+        ticks++;
+    }
+
+    w->result.games++;
+    w->result.ticks += ticks;
+    w->result.length_sum += g->snake.len;
+    if (g->snake.len > w->result.max_length)
+        w->result.max_length = g->snake.len;
+
+    if (g->state == WON) w->result.won++;
+    else if (g->state == LOST) w->result.lost++;
+    else w->result.stopped++;
+}
+
+static void sim_work(sim_worker *w) {
+    sim_pool *p = w->pool;
+    sim_range r;
+
+    /* The shares seen before looking for work. Anything shared later wakes the worker up. */
+    pthread_mutex_lock(&p->lock);
+    unsigned long seen = p->shared;
+    pthread_mutex_unlock(&p->lock);
+
+    for (;;) {
+        if (!deque_pop(&w->deque, &r) && !sim_steal(w, &r)) {
+            /* Nothing to take: either everything is done, or the remaining games are being played
+             * or split by other workers. Sleep until one of them shares a range or the run ends. */
+            pthread_mutex_lock(&p->lock);
+            while (p->remaining > 0 && p->shared == seen)
+                pthread_cond_wait(&p->work, &p->lock);
+            bool done = p->remaining == 0;
+            seen = p->shared;
+            pthread_mutex_unlock(&p->lock);
+            if (done)
+                return;
+
+            continue;
+        }
+
+        /* Keep the first half, leave the rest to be stolen. */
+        bool split = r.count > SIM_GRAIN;
+        while (r.count > SIM_GRAIN) {
+            long half = r.count / 2;
+            deque_push(&w->deque, (sim_range) { r.first + half, r.count - half });
+            r.count = half;
+        }
+
+        if (split) {
+            pthread_mutex_lock(&p->lock);
+            p->shared++;
+            pthread_cond_broadcast(&p->work);
+            pthread_mutex_unlock(&p->lock);
+        }
+
+        for (long n = r.first; n < r.first + r.count; n++)
+            sim_play(w, n);
+
+        pthread_mutex_lock(&p->lock);
+        p->remaining -= r.count;
+        if (p->remaining == 0)
+            pthread_cond_broadcast(&p->work);
+        seen = p->shared;
+        pthread_mutex_unlock(&p->lock);
+    }
+}
+
+static void *sim_thread(void *arg) {
+    sim_worker *w = arg;
+    sim_pool *p = w->pool;
+    unsigned long generation = 0;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (!p->quit && p->generation == generation)
+            pthread_cond_wait(&p->start, &p->lock);
+        if (p->quit)
+            break;
+        generation = p->generation;
+        pthread_mutex_unlock(&p->lock);
+
+        sim_work(w);
+
+        pthread_mutex_lock(&p->lock);
+        if (--p->busy == 0)
+            pthread_cond_signal(&p->finish);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return NULL;
+}
+
+sim_pool *sim_create(const sim_config *config) {
+    if (config->cols < GAME_MIN_SIZE || config->rows < GAME_MIN_SIZE)
+        return NULL;
+
+    sim_pool *p = calloc(1, sizeof(sim_pool));
+    if (p == NULL)
+        return NULL;
+
+    p->config = *config;
+    p->nthreads = config->threads;
+    if (p->nthreads <= 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        p->nthreads = ncpu > 0 ? ncpu : 1;
+    }
+
+    p->workers = calloc(p->nthreads, sizeof(sim_worker));
+    p->results = calloc(p->nthreads, sizeof(sim_result));
+    if (p->workers == NULL || p->results == NULL) {
+        free(p->workers);
+        free(p->results);
+        free(p);
+        return NULL;
+    }
+
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->start, NULL);
+    pthread_cond_init(&p->finish, NULL);
+    pthread_cond_init(&p->work, NULL);
+
+    for (int i = 0; i < p->nthreads; i++) {
+        sim_worker *w = &p->workers[i];
+        w->pool = p;
+        w->index = i;
+        rng_init(&w->victim_rng, i);
+        pthread_mutex_init(&w->deque.lock, NULL);
+
+        if (pthread_create(&w->thread, NULL, sim_thread, w) != 0) {
+            p->nthreads = i;
+            sim_destroy(p);
+            return NULL;
+        }
+    }
+
+    return p;
+}
+
+void sim_destroy(sim_pool *p) {
+    if (p == NULL)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    p->quit = true;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int i = 0; i < p->nthreads; i++) {
+        pthread_join(p->workers[i].thread, NULL);
+        pthread_mutex_destroy(&p->workers[i].deque.lock);
+        game_free(&p->workers[i].game);
+    }
+
+    pthread_cond_destroy(&p->work);
+    pthread_cond_destroy(&p->finish);
+    pthread_cond_destroy(&p->start);
+    pthread_mutex_destroy(&p->lock);
+    free(p->workers);
+    free(p->results);
+    free(p);
+}
+
+sim_result sim_run_until_done(sim_pool *p, long total_games, game_policy policy, void *userdata) {
+    sim_result total = { 0 };
+
+    /* Hand each worker an equal contiguous share, stealing evens out the rest. */
+    long first = 0;
+    for (int i = 0; i < p->nthreads; i++) {
+        sim_worker *w = &p->workers[i];
+        long count = total_games / p->nthreads + (i < total_games % p->nthreads);
+        memset(&w->result, 0, sizeof(sim_result));
+        w->deque.top = w->deque.bottom = 0;
+        if (count > 0)
+            deque_push(&w->deque, (sim_range) { first, count });
+        first += count;
+    }
+
+    pthread_mutex_lock(&p->lock);
+    p->policy = policy;
+    p->userdata = userdata;
+    p->remaining = total_games;
+    p->busy = p->nthreads;
+    p->generation++;
+    pthread_cond_broadcast(&p->start);
+    while (p->busy > 0)
+        pthread_cond_wait(&p->finish, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int i = 0; i < p->nthreads; i++) {
+        const sim_result *r = &p->workers[i].result;
+        p->results[i] = *r;
+
+        total.games += r->games;
+        total.won += r->won;
+        total.lost += r->lost;
+        total.stopped += r->stopped;
+        total.ticks += r->ticks;
+        total.length_sum += r->length_sum;
+        if (r->max_length > total.max_length)
+            total.max_length = r->max_length;
+    }
+
+    return total;
+}
+
+const sim_result *sim_thread_results(const sim_pool *p, int *nthreads) {
+    *nthreads = p->nthreads;
+    return p->results;
+}
@@ -0,0 +1,43 @@
+#ifndef SNAKERL_SIM_H
+#define SNAKERL_SIM_H
+
+/* Plays large numbers of independent games on a pool of worker threads.
+ * Every worker owns a deque of game ranges: it splits its ranges and works on the newest half,
+ * idle workers steal the oldest (largest) ranges from the others. Game lengths vary wildly,
+ * so this keeps all cores busy where a fixed split would leave them idle. */
+
+#include "game.h"
+
+/* Chooses the direction for the next tick. Called concurrently from all worker threads,
+ * the userdata must be safe to share. */
+typedef direction (*game_policy)(const game_data *g, void *userdata);
+
+typedef struct {
+    int threads;    /* 0 uses all online CPUs. */
+    int cols, rows;
+    int level;
+    uint64_t seed;  /* The n-th game of a run is seeded with rng_seed(seed, n), independent of scheduling. */
+    long max_ticks; /* Games running longer are stopped, 0 for no limit. */
+} sim_config;
+
+typedef struct {
+    long games;
+    long won, lost, stopped;
+    long long ticks;
+    long long length_sum; /* Sum of the final snake lengths. */
+    int max_length;
+} sim_result;
+
+typedef struct sim_pool sim_pool;
+
+/* Starts the worker threads. Returns NULL on failure or if the board is smaller than GAME_MIN_SIZE. */
+sim_pool *sim_create(const sim_config *config);
+void sim_destroy(sim_pool *p);
+
+/* Plays total_games games to the end and returns the combined results.
+ * The results of the individual workers are available from sim_thread_results(). */
+sim_result sim_run_until_done(sim_pool *p, long total_games, game_policy policy, void *userdata);
+
+const sim_result *sim_thread_results(const sim_pool *p, int *nthreads);
+
+#endif
@@ -0,0 +1,178 @@
+/* Checks the bitboard operations against a breadth-first search over a plain array of cells,
+ * on random boards with and without wrap. The sizes lean towards the edge cases of the shifts:
+ * 64 columns, where a row takes the whole word, and the narrowest boards.
+ * Exits with 1 on the first difference. */
+
+#include <stdio.h>
+
+#include "bitboard.h"
+
+#define BOARDS 6000
+#define NCELLS (BITBOARD_MAX_COLS * BITBOARD_MAX_ROWS)
+
+typedef struct {
+    int cols, rows;
+    bool wrap;
+    bool open[NCELLS], from[NCELLS], to[NCELLS];
+    bool seen[NCELLS];
+    int dist[NCELLS], queue[NCELLS];
+} board;
+
+/* The cell next to another one, around the edges with wrap and -1 past a wall. */
+static int step(const board *b, int cell, direction d) {
+    vec2i v = vec2i_step((vec2i) { cell % b->cols, cell / b->cols }, d, 1);
+    if (v.x < 0 || v.x >= b->cols || v.y < 0 || v.y >= b->rows) {
+        if (!b->wrap)
+            return -1;
+        v.x = (v.x + b->cols) % b->cols;
+        v.y = (v.y + b->rows) % b->rows;
+    }
+    return v.y*b->cols + v.x;
+}
+
+/* Marks seen what the cells of from get to over open cells. Returns the moves to the nearest cell of to, -1 if none. */
+static int search(board *b) {
+    const int ncells = b->cols * b->rows;
+    int head = 0, tail = 0, found = -1;
+    for (int c = 0; c < ncells; c++) {
+        b->seen[c] = b->from[c];
+        b->dist[c] = 0;
+        if (b->from[c])
+            b->queue[tail++] = c;
+    }
+
+    while (head < tail) {
+        int c = b->queue[head++];
+        if (b->to[c] && found < 0)
+            found = b->dist[c];
+
+        for (int d = UP; d <= LEFT; d++) {
+            int n = step(b, c, d);
+            if (n >= 0 && !b->seen[n] && b->open[n]) {
+                b->seen[n] = true;
+                b->dist[n] = b->dist[c] + 1;
+                b->queue[tail++] = n;
+            }
+        }
+    }
+
+    return found;
+}
+
+static bool fail(const board *b, const char *what) {
+    printf("%dx%d %s: %s\n", b->cols, b->rows, b->wrap ? "wrap" : "walls", what);
+    return false;
+}
+
+static bool check_board(board *b, rng_state *rng) {
+    static const int widths[] = { 2, 3, 63, 64 };
+    b->cols = rng_below(rng, 2) ? widths[rng_below(rng, 4)] : 2 + (int) rng_below(rng, BITBOARD_MAX_COLS - 1);
+    b->rows = rng_below(rng, 8) ? 2 + (int) rng_below(rng, 40) : 2 + (int) rng_below(rng, BITBOARD_MAX_ROWS - 1);
+    b->wrap = rng_below(rng, 2);
+
+    const int ncells = b->cols * b->rows;
+    const uint32_t density = rng_below(rng, 100);
+    bitboard open, from, to;
+    bitboard_clear(&open, b->cols, b->rows);
+    bitboard_clear(&from, b->cols, b->rows);
+    bitboard_clear(&to, b->cols, b->rows);
+    int nopen = 0;
+    for (int c = 0; c < ncells; c++) {
+        vec2i v = { c % b->cols, c / b->cols };
+        b->open[c] = rng_below(rng, 100) >= density;
+        b->from[c] = rng_below(rng, ncells) == 0;
+        b->to[c] = rng_below(rng, ncells) < 2;
+        if (b->open[c]) { bitboard_set(&open, v); nopen++; }
+        if (b->from[c]) bitboard_set(&from, v);
+        if (b->to[c]) bitboard_set(&to, v);
+    }
+
+    if (bitboard_popcount(&open) != nopen)
+        return fail(b, "bitboard_popcount");
+
+    bool meet = false;
+    for (int c = 0; c < ncells; c++)
+        meet |= b->open[c] && b->to[c];
+    if (bitboard_intersects(&open, &to) != meet)
+        return fail(b, "bitboard_intersects");
+
+    if (bitboard_distance(&from, &to, &open, b->wrap) != search(b))
+        return fail(b, "bitboard_distance");
+
+    bitboard reach = from;
+    int nreach = bitboard_flood(&reach, &open, b->wrap), nseen = 0;
+    for (int c = 0; c < ncells; c++) {
+        nseen += b->seen[c];
+        if (bitboard_get(&reach, (vec2i) { c % b->cols, c / b->cols }) != b->seen[c])
+            return fail(b, "bitboard_flood cells");
+    }
+    if (nreach != nseen)
+        return fail(b, "bitboard_flood count");
+
+    bitboard near;
+    bitboard_neighbours(&near, &from, b->wrap);
+    for (int c = 0; c < ncells; c++) {
+        bool next = false;
+        int free = 0;
+        for (int d = UP; d <= LEFT; d++) {
+            int n = step(b, c, d);
+            next |= n >= 0 && b->from[n];
+            free += n >= 0 && b->open[n];
+        }
+
+        vec2i v = { c % b->cols, c / b->cols };
+        if (bitboard_get(&near, v) != next)
+            return fail(b, "bitboard_neighbours");
+        /* A torus 2 cells across has the same cell on both sides, it is counted once. */
+        if (b->cols > 2 && b->rows > 2 && bitboard_free_neighbours(&open, v, b->wrap) != free)
+            return fail(b, "bitboard_free_neighbours");
+    }
+
+    return true;
+}
+
+/* The masks of games in progress against their boards. */
+static bool check_game(int n, rng_state *rng) {
+    game_data g = {0};
+    game_init(&g, GAME_MIN_SIZE + rng_below(rng, BITBOARD_MAX_COLS - GAME_MIN_SIZE + 1),
+              GAME_MIN_SIZE + rng_below(rng, 30), n % nlevels, n);
+    for (int t = rng_below(rng, 200); t > 0 && g.state == RUNNING; t--)
+        game_step(&g, rng_below(rng, 3) == 0 ? (direction) rng_below(rng, 4) : DIRECTION_NOVALUE);
+
+    bool ok = true;
+    game_bitboards bb;
+    if (g.state != RUNNING) {
+        /* Only running games are looked at. */
+    } else if (!bitboard_fromgame(&bb, &g) || bb.wrap == levels[g.level].wall_collisions) {
+        ok = false;
+    } else {
+        for (int c = 0; c < g.cols * g.rows && ok; c++) {
+            vec2i v = { c % g.cols, c / g.cols };
+            ok = bitboard_get(&bb.body, v) == (g.board[c] == SNAKE) &&
+                 bitboard_get(&bb.food, v) == (g.board[c] == FOOD) &&
+                 bitboard_get(&bb.open, v) == (g.board[c] != SNAKE);
+        }
+    }
+
+    if (!ok)
+        printf("%dx%d %s game %d: bitboard_fromgame\n", g.cols, g.rows, levels[g.level].desc, n);
+    game_free(&g);
+    return ok;
+}
+
+int main(void) {
+    static board b;
+    rng_state rng;
+    rng_init(&rng, 1);
+
+    for (int i = 0; i < BOARDS; i++)
+        if (!check_board(&b, &rng))
+            return 1;
+
+    for (int n = 0; n < 1000; n++)
+        if (!check_game(n, &rng))
+            return 1;
+
+    printf("bitboard ok\n");
+    return 0;
+}
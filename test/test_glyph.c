@@ -0,0 +1,113 @@
+/* Checks the glyph table of segment_symbol() against the branch cascade it replaced, which worked
+ * from the positions of the segments, on every segment after every tick of games played to a full
+ * board and of random games with transitions through the walls. Exits with 1 on the first difference. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ai.h"
+#include "const.h"
+#include "sim.h"
+
+/* The original segment_symbol(), segment 0 is the head. */
+static char cascade_symbol(const vec2i *seg, int len, int i) {
+    char symbol = '?';
+    if (i == 0) { /* Head */
+        symbol = seg_head;
+    } else if (i == len-1) { /* Last segment of the tail */
+        if (seg[i].x - seg[i-1].x == 0) symbol = seg_v;
+        if (seg[i].y - seg[i-1].y == 0) symbol = seg_h;
+    } else {
+        vec2i AB = { seg[i].x - seg[i-1].x, seg[i].y - seg[i-1].y };
+        vec2i BC = { seg[i+1].x - seg[i].x, seg[i+1].y - seg[i].y };
+        if (AB.y == -1 || AB.y > 1) { /* up */
+            if (BC.x == 0)
+                symbol = seg_v;
+            else if (BC.x == -1 || BC.x >  1)
+                symbol = seg_ul;
+            else if (BC.x ==  1 || BC.x < -1)
+                symbol = seg_ur;
+        } else if (AB.y == 1 || AB.y < -1) { /* down */
+            if (BC.x == 0)
+                symbol = seg_v;
+            else if (BC.x == -1 || BC.x >  1)
+                symbol = seg_dl;
+            else if (BC.x ==  1 || BC.x < -1)
+                symbol = seg_dr;
+        } else if (AB.x == -1 || AB.x > 1) { /* left */
+            if (BC.y == 0)
+                symbol = seg_h;
+            else if (BC.y == -1 || BC.y >  1)
+                symbol = seg_lu;
+            else if (BC.y ==  1 || BC.y < -1)
+                symbol = seg_ld;
+        } else if (AB.x == 1 || AB.x < -1) { /* right */
+            if (BC.y == 0)
+                symbol = seg_h;
+            else if (BC.y == -1 || BC.y >  1)
+                symbol = seg_ru;
+            else if (BC.y ==  1 || BC.y < -1)
+                symbol = seg_rd;
+        }
+    }
+
+    return symbol;
+}
+
+/* Turns at random. */
+static direction random_turn(const game_data *g, void *userdata) {
+    (void) g;
+    return rng_below(userdata, 3) == 0 ? (direction) rng_below(userdata, 4) : DIRECTION_NOVALUE;
+}
+
+static bool check_games(int cols, int rows, int level, int games, game_policy policy, void *userdata) {
+    game_data g = {0};
+    vec2i *seg = malloc(cols * rows * sizeof(vec2i));
+    bool ok = seg != NULL;
+
+    for (int n = 0; ok && n < games; n++) {
+        game_init(&g, cols, rows, level, rng_seed(4, n));
+        while (ok && game_step(&g, policy(&g, userdata)) == RUNNING) {
+            for (game_iter it = game_iter_begin(&g); it.i < g.snake.len; game_iter_next(&g, &it))
+                seg[it.i] = it.pos;
+
+            for (int i = 0; ok && i < g.snake.len; i++) {
+                char table = segment_symbol(&g, i), cascade = cascade_symbol(seg, g.snake.len, i);
+                if (table != cascade) {
+                    printf("%dx%d %s game %d tick %llu segment %d of %d: glyph %d, was %d\n",
+                           cols, rows, levels[level].desc, n, (unsigned long long) g.ticks, i, g.snake.len,
+                           (unsigned char) table, (unsigned char) cascade);
+                    ok = false;
+                }
+            }
+        }
+    }
+
+    free(seg);
+    game_free(&g);
+    return ok;
+}
+
+int main(void) {
+    static const struct { int cols, rows, games; } filled[] = {
+        { 8, 6, 10 }, { 9, 7, 10 }, { 4, 5, 10 },
+    };
+
+    bool ok = true;
+    for (int level = 0; level < nlevels; level++) {
+        /* Games played to a full board, the odd torus of EASY wraps around on the cycle itself. */
+        for (size_t b = 0; b < sizeof(filled)/sizeof(*filled); b++) {
+            ai_cycle *c = ai_cycle_create(filled[b].cols, filled[b].rows, !levels[level].wall_collisions);
+            ok = ok && c != NULL && check_games(filled[b].cols, filled[b].rows, level, filled[b].games, ai_hamilton, c);
+            ai_cycle_destroy(c);
+        }
+
+        rng_state rng;
+        rng_init(&rng, 5);
+        ok = ok && check_games(20, 10, level, 200, random_turn, &rng);
+    }
+
+    if (ok)
+        printf("glyph ok\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+/* Checks the state of games on every tick of games that end in all the ways a game can end:
+ * filled boards, collisions and wraps through the walls.
+ * - The incremental Zobrist hash matches game_hash().
+ * - A snapshot restored into another game gives the same snapshot back.
+ * - A recorded step, and every 64 ticks a stack of 16 of them, undone gives the state before.
+ * Exits with 1 on the first difference. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ai.h"
+#include "sim.h"
+
+#define UNDO_DEPTH 16
+
+typedef struct {
+    game_data g, copy;
+    void *before, *after;
+    size_t size;
+    game_undo undo[UNDO_DEPTH];
+} checker;
+
+static bool fail(const checker *c, const char *what, int n) {
+    const game_data *g = &c->g;
+    printf("%dx%d %s game %d tick %llu: %s\n",
+           g->cols, g->rows, levels[g->level].desc, n, (unsigned long long) g->ticks, what);
+    return false;
+}
+
+/* Heads for the food without running into the snake or a wall where it can, the way is picked at random.
+ * The userdata is an rng_state. */
+static direction wander(const game_data *g, void *userdata) {
+    direction best = DIRECTION_NOVALUE;
+    int best_dist = 0;
+    for (int d = UP; d <= LEFT; d++) {
+        vec2i next = vec2i_step(g->snake.head_pos, d, 1);
+        if (next.x < 0 || next.x >= g->cols || next.y < 0 || next.y >= g->rows) {
+            if (levels[g->level].wall_collisions)
+                continue;
+            next = game_wrap(g, next);
+        }
+        if ((d ^ g->dir) == 2 || g->board[next.y*g->cols + next.x] == SNAKE)
+            continue;
+
+        int dist = abs(next.x - g->food.x) + abs(next.y - g->food.y) + rng_below(userdata, 4);
+        if (best == DIRECTION_NOVALUE || dist < best_dist) {
+            best = d;
+            best_dist = dist;
+        }
+    }
+    return best;
+}
+
+/* Records the steps the policy takes from here and undoes them, the game must be as before. */
+static bool check_undo(checker *c, int depth, game_policy policy, void *userdata) {
+    game_snapshot(&c->g, c->before);
+
+    int n = 0;
+    while (n < depth && c->g.state == RUNNING) {
+        game_step_record(&c->g, policy(&c->g, userdata), &c->undo[n]);
+        n++;
+    }
+    while (n > 0)
+        game_undo_step(&c->g, &c->undo[--n]);
+
+    game_snapshot(&c->g, c->after);
+    return memcmp(c->before, c->after, c->size) == 0;
+}
+
+/* Plays the games, with a random turn instead of the policy one tick in every 1/random. */
+static bool check_games(checker *c, int level, int games, game_policy policy, void *userdata, int random) {
+    game_data *g = &c->g;
+    rng_state rng;
+    rng_init(&rng, 1);
+
+    for (int n = 0; n < games; n++) {
+        game_init(g, g->cols, g->rows, level, rng_seed(2, n));
+        while (g->state == RUNNING) {
+            if (!check_undo(c, g->ticks % 64 == 0 ? UNDO_DEPTH : 1, policy, userdata))
+                return fail(c, "undo does not give the state back", n);
+
+            direction d = random > 0 && rng_below(&rng, random) == 0 ? (direction) rng_below(&rng, 4) : policy(g, userdata);
+            /* The hash is not kept once the game is lost. */
+            if (game_step(g, d) != LOST && g->hash != game_hash(g))
+                return fail(c, "the hash differs from game_hash()", n);
+
+            game_snapshot(g, c->before);
+            game_restore(&c->copy, c->before);
+            game_snapshot(&c->copy, c->after);
+            if (memcmp(c->before, c->after, c->size) != 0)
+                return fail(c, "the restored game snapshots differently", n);
+        }
+    }
+
+    return true;
+}
+
+static bool check_board(int cols, int rows, int level, int games, game_policy policy, void *userdata, int random) {
+    checker *c = calloc(1, sizeof(checker));
+    if (c == NULL)
+        return false;
+
+    game_init(&c->g, cols, rows, level, 0);
+    game_init(&c->copy, cols, rows, level, 0);
+    c->size = game_snapshot_size(cols, rows);
+    c->before = malloc(c->size);
+    c->after = malloc(c->size);
+
+    bool ok = c->before != NULL && c->after != NULL && check_games(c, level, games, policy, userdata, random);
+
+    free(c->before);
+    free(c->after);
+    game_free(&c->g);
+    game_free(&c->copy);
+    free(c);
+    return ok;
+}
+
+int main(void) {
+    static const struct { int cols, rows, games; } filled[] = {
+        { 8, 6, 20 }, { 9, 7, 20 }, { 16, 12, 2 },
+    };
+
+    bool ok = true;
+    for (int level = 0; level < nlevels; level++) {
+        /* Games played to a full board. */
+        for (size_t b = 0; b < sizeof(filled)/sizeof(*filled); b++) {
+            ai_cycle *c = ai_cycle_create(filled[b].cols, filled[b].rows, !levels[level].wall_collisions);
+            ok = ok && c != NULL && check_board(filled[b].cols, filled[b].rows, level, filled[b].games, ai_hamilton, c, 0);
+            ai_cycle_destroy(c);
+        }
+
+        /* Games that mostly end in a collision. */
+        rng_state rng;
+        rng_init(&rng, 3);
+        ok = ok && check_board(50, 25, level, 100, wander, &rng, 8);
+    }
+
+    if (ok)
+        printf("state ok\n");
+    return ok ? 0 : 1;
+}
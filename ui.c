@@ -1,6 +1,10 @@
 #include <stdbool.h>
+#include <string.h>
 #include <math.h>
 #include "ui.h"
+#include "fx.h"
+#include "post.h"
+#include "glyph.h"
 
 /* Make stb_image use SDL memory allocation functions.
  * In that way, by clearing SDL_PREALLOC flag of the surface
@@ -26,6 +30,7 @@ typedef struct {
     SDL_Surface *bitmap;
     SDL_Color palette[2];
     int char_w, char_h;
+    glyph_font mask; /* The same glyphs packed for 32-bit surfaces, rows is NULL if they do not fit. */
 } ui_font;
 
 SDL_Window *ui_window;
@@ -38,7 +43,47 @@ struct ui_effects ui_effects = {
     .crt_intensity = 0.15,
 };
 
+enum {
+    CELL_DIRTY   = 1 << 0, /* Rendered in this frame, to be post-processed and presented. */
+    CELL_STALE   = 1 << 1, /* The pixels do not match the front buffer, the cell must be rendered again. */
+    CELL_OVERLAY = 1 << 2, /* Covered by a texture drawn with ui_blit() in this frame. */
+};
+
+typedef struct {
+    SDL_Surface *texture;
+    SDL_Rect area;
+} ui_overlay;
+
+/* The frame is drawn into the back buffer, ui_present() renders the cells that differ
+ * from the front buffer, which holds what is on the screen. */
+static struct {
+    ui_cell *back, *front;
+    uint8_t *flags;
+    ui_color fg, bg; /* Colors of the next ui_putch(). */
+    ui_overlay *overlays;
+    int noverlays, overlays_cap;
+    SDL_Rect *rects; /* Areas updated by ui_present(). */
+    bool crt;        /* The effects the pixels on the screen were processed with. */
+    double crt_intensity;
+} grid;
+
+/* Number of glyphs in the cache and the buckets of its hash table, both powers of two. */
+#define GLYPH_CACHE_SIZE 256
+#define GLYPH_CACHE_BUCKETS 512
+
+/* Glyphs already colored and converted to the window pixel format, keyed by the glyph and its colors.
+ * The least recently used glyph is replaced when the cache is full. */
+static struct {
+    SDL_Surface *atlas; /* One slot per glyph, BITMAP_COLS slots in a row. */
+    uint64_t key[GLYPH_CACHE_SIZE];
+    uint64_t used[GLYPH_CACHE_SIZE]; /* When the slot was used last, 0 if it is free. */
+    int next[GLYPH_CACHE_SIZE];      /* The next slot in the same bucket, -1 ends the chain. */
+    int bucket[GLYPH_CACHE_BUCKETS];
+    uint64_t clock;
+} glyphs;
+
 static ui_font font;
+static fx_crt crt;
 
 static inline int ui_getmargin_w(void) {
     return (ui_surface->w - font.char_w*ui_cols)/2;
@@ -48,16 +93,32 @@ static inline int ui_getmargin_h(void) {
     return (ui_surface->h - font.char_h*ui_rows)/2;
 }
 
-static void ui_effect_crt(SDL_Surface *screen) {
-    double crtk = 1 - ui_effects.crt_intensity;
+static inline bool ui_color_eq(ui_color a, ui_color b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
 
-    SDL_LockSurface(screen);
+static inline bool ui_cell_eq(ui_cell a, ui_cell b) {
+    return a.glyph == b.glyph && ui_color_eq(a.fg, b.fg) && ui_color_eq(a.bg, b.bg);
+}
+
+/* The area of a cell on the surface. The cells on the edges of the grid also cover the margins. */
+static SDL_Rect ui_getcellrect(int x, int y) {
+    int x0 = x == 0 ? 0 : ui_getmargin_w() + x*font.char_w;
+    int y0 = y == 0 ? 0 : ui_getmargin_h() + y*font.char_h;
+    int x1 = x == ui_cols-1 ? ui_surface->w : ui_getmargin_w() + (x+1)*font.char_w;
+    int y1 = y == ui_rows-1 ? ui_surface->h : ui_getmargin_h() + (y+1)*font.char_h;
+    return (SDL_Rect) { x0, y0, x1-x0, y1-y0 };
+}
 
-    Uint32 *pixels = screen->pixels;
-    for (int y = 0; y < screen->h; y++) {
-        for (int x = 0; x < screen->w; x++) {
+/* Generic version for surface formats without 8-bit channels. */
+static void ui_effect_crt_generic(SDL_Surface *screen, const SDL_Rect *r) {
+    double crtk = 1 - ui_effects.crt_intensity;
+
+    for (int y = r->y; y < r->y + r->h; y++) {
+        Uint32 *pixels = (Uint32 *) ((Uint8 *) screen->pixels + y*screen->pitch);
+        for (int x = r->x; x < r->x + r->w; x++) {
             SDL_Color pixel;
-            SDL_GetRGBA(pixels[y*screen->w + x], screen->format, &pixel.r, &pixel.g, &pixel.b, &pixel.a);
+            SDL_GetRGBA(pixels[x], screen->format, &pixel.r, &pixel.g, &pixel.b, &pixel.a);
 
             SDL_Color out = pixel;
 
@@ -67,11 +128,34 @@ static void ui_effect_crt(SDL_Surface *screen) {
             case 2: out.g = crtk*pixel.g; out.b = crtk*pixel.b; break;
             }
 
-            pixels[y*screen->w + x] = SDL_MapRGBA(screen->format, out.r, out.g, out.b, out.a);
+            pixels[x] = SDL_MapRGBA(screen->format, out.r, out.g, out.b, out.a);
         }
     }
+}
+
+/* Whether the lookup tables in crt match the surface, checked once per frame by ui_effect_crt_prepare(). */
+static bool crt_fast;
+
+static void ui_effect_crt_prepare(SDL_Surface *screen) {
+    const SDL_PixelFormat *fmt = screen->format;
+    crt_fast = fmt->BytesPerPixel == 4 && !fmt->Rloss && !fmt->Gloss && !fmt->Bloss;
+    if (!crt_fast)
+        return;
+
+    /* The tables are rebuilt only when the intensity or the surface format changes. */
+    if (crt.intensity != ui_effects.crt_intensity ||
+        crt.rmask != fmt->Rmask || crt.gmask != fmt->Gmask || crt.bmask != fmt->Bmask) {
+        fx_crt_init(&crt, ui_effects.crt_intensity, fmt->Rmask, fmt->Gmask, fmt->Bmask);
+    }
+}
+
+/* Post-processing pass, run in parallel over bands of the window surface. */
+static void ui_effect_crt(SDL_Surface *screen, const SDL_Rect *band, void *userdata) {
+    (void) userdata;
 
-    SDL_UnlockSurface(screen);
+    if (crt_fast)
+        fx_crt_apply(&crt, screen->pixels, screen->pitch, band->x, band->y, band->w, band->h);
+    else ui_effect_crt_generic(screen, band);
 }
 
 static int ui_loadfont(const char *filename, ui_font *font) {
@@ -102,11 +186,21 @@ static int ui_loadfont(const char *filename, ui_font *font) {
 
     SDL_UnlockSurface(font->bitmap);
 
-    stbi_image_free(data);
-
     font->char_w = font->bitmap->w / BITMAP_COLS;
     font->char_h = font->bitmap->h / BITMAP_ROWS;
 
+    if (glyph_font_init(&font->mask, font->char_w, font->char_h)) {
+        for (int c = 0; c < 256; c++) {
+            const int x0 = (c % BITMAP_COLS) * font->char_w, y0 = (c / BITMAP_ROWS) * font->char_h;
+            for (int y = 0; y < font->char_h; y++)
+                for (int x = 0; x < font->char_w; x++)
+                    if (pixels[(y0+y)*w + x0+x] != pixels[0])
+                        glyph_setpixel(&font->mask, c, x, y);
+        }
+    } else font->mask.rows = NULL;
+
+    stbi_image_free(data);
+
     font->palette[INDEX_BG] = bg_default;
     font->palette[INDEX_FG] = fg_default;
     SDL_SetPaletteColors(font->bitmap->format->palette, font->palette, 0, 2);
@@ -140,7 +234,22 @@ SDL_Surface *ui_loadtexture(const char *filename) {
 }
 
 void ui_quit(void) {
+    post_quit();
+    SDL_free(grid.back);
+    SDL_free(grid.front);
+    SDL_free(grid.flags);
+    SDL_free(grid.overlays);
+    SDL_free(grid.rects);
+    grid.back = grid.front = NULL;
+    grid.flags = NULL;
+    grid.overlays = NULL;
+    grid.noverlays = grid.overlays_cap = 0;
+    grid.rects = NULL;
+
+    SDL_FreeSurface(glyphs.atlas);
+    glyphs.atlas = NULL;
     SDL_FreeSurface(font.bitmap);
+    glyph_font_free(&font.mask);
 
     if (ui_window != NULL)
         SDL_DestroyWindow(ui_window);
@@ -189,34 +298,159 @@ int ui_init(const char *title, const char *filename, int w, int h) {
         return 0;
     }
 
+    glyphs.atlas = SDL_CreateRGBSurfaceWithFormat(0, BITMAP_COLS * font.char_w,
+                                                  GLYPH_CACHE_SIZE / BITMAP_COLS * font.char_h,
+                                                  ui_surface->format->BitsPerPixel, ui_surface->format->format);
+    if (glyphs.atlas == NULL) {
+        SDL_Log("Unable to create glyph cache: %s", SDL_GetError());
+        ui_quit();
+        return 0;
+    }
+
+    SDL_SetSurfaceBlendMode(glyphs.atlas, SDL_BLENDMODE_NONE);
+    memset(glyphs.used, 0, sizeof(glyphs.used));
+    memset(glyphs.bucket, -1, sizeof(glyphs.bucket));
+
+    /* Every cell is rendered in the first frame. */
+    grid.back = SDL_malloc(ui_cols*ui_rows * sizeof(ui_cell));
+    grid.front = SDL_malloc(ui_cols*ui_rows * sizeof(ui_cell));
+    grid.flags = SDL_malloc(ui_cols*ui_rows);
+    grid.rects = SDL_malloc(ui_cols*ui_rows * sizeof(SDL_Rect));
+    if (grid.back == NULL || grid.front == NULL || grid.flags == NULL || grid.rects == NULL) {
+        SDL_Log("Unable to allocate %dx%d cells", ui_cols, ui_rows);
+        ui_quit();
+        return 0;
+    }
+
+    memset(grid.flags, CELL_STALE, ui_cols*ui_rows);
+    grid.fg = (ui_color) { font.palette[INDEX_FG].r, font.palette[INDEX_FG].g, font.palette[INDEX_FG].b };
+    grid.bg = (ui_color) { font.palette[INDEX_BG].r, font.palette[INDEX_BG].g, font.palette[INDEX_BG].b };
+    grid.crt = ui_effects.crt;
+    grid.crt_intensity = ui_effects.crt_intensity;
+    ui_clear();
+
+    if (!post_init()) {
+        ui_quit();
+        return 0;
+    }
+
     return 1;
 }
 
 void ui_setbg(ui_color color) {
-    font.palette[INDEX_BG] = (SDL_Color) { color.r, color.g, color.b, SDL_ALPHA_OPAQUE };
-    SDL_SetPaletteColors(font.bitmap->format->palette, font.palette, 0, 2);
+    grid.bg = color;
 }
 
 void ui_setfg(ui_color color) {
-    font.palette[INDEX_FG] = (SDL_Color) { color.r, color.g, color.b, SDL_ALPHA_OPAQUE };
-    SDL_SetPaletteColors(font.bitmap->format->palette, font.palette, 0, 2);
+    grid.fg = color;
 }
 
-void ui_putch(int x, int y, char symbol) {
-    unsigned char c = symbol;
-    SDL_Rect srcrect = {
-        (c % BITMAP_COLS) * font.char_w,
-        (c / BITMAP_ROWS) * font.char_h,
+static inline int glyph_hash(uint64_t key) {
+    return (key * 0x9e3779b97f4a7c15ull) >> 32 & (GLYPH_CACHE_BUCKETS - 1);
+}
+
+static inline SDL_Rect glyph_slotrect(int slot) {
+    return (SDL_Rect) {
+        (slot % BITMAP_COLS) * font.char_w,
+        (slot / BITMAP_COLS) * font.char_h,
         font.char_w, font.char_h
     };
+}
+
+/* Returns the slot of the atlas holding the glyph in the given colors, rendering it on a miss. */
+static int ui_getglyph(unsigned char glyph, ui_color fg, ui_color bg) {
+    uint64_t key = (uint64_t) glyph << 48 |
+        (uint64_t) fg.r << 40 | (uint64_t) fg.g << 32 | (uint64_t) fg.b << 24 |
+        (uint64_t) bg.r << 16 | (uint64_t) bg.g << 8 | (uint64_t) bg.b;
+    int bucket = glyph_hash(key);
+
+    for (int slot = glyphs.bucket[bucket]; slot >= 0; slot = glyphs.next[slot]) {
+        if (glyphs.key[slot] == key) {
+            glyphs.used[slot] = ++glyphs.clock;
+            return slot;
+        }
+    }
 
-    SDL_Rect dstrect = {
-        ui_getmargin_w() + x * font.char_w,
-        ui_getmargin_h() + y * font.char_h,
+    /* Replace the least recently used slot, a free one if there is any. */
+    int slot = 0;
+    for (int i = 1; i < GLYPH_CACHE_SIZE; i++)
+        if (glyphs.used[i] < glyphs.used[slot])
+            slot = i;
+
+    if (glyphs.used[slot] != 0) {
+        int *link = &glyphs.bucket[glyph_hash(glyphs.key[slot])];
+        while (*link != slot)
+            link = &glyphs.next[*link];
+        *link = glyphs.next[slot];
+    }
+
+    glyphs.key[slot] = key;
+    glyphs.used[slot] = ++glyphs.clock;
+    glyphs.next[slot] = glyphs.bucket[bucket];
+    glyphs.bucket[bucket] = slot;
+
+    /* The font palette is only changed here, a blit from it converts the glyph into the atlas format. */
+    font.palette[INDEX_FG] = (SDL_Color) { fg.r, fg.g, fg.b, SDL_ALPHA_OPAQUE };
+    font.palette[INDEX_BG] = (SDL_Color) { bg.r, bg.g, bg.b, SDL_ALPHA_OPAQUE };
+    SDL_SetPaletteColors(font.bitmap->format->palette, font.palette, 0, 2);
+
+    SDL_Rect srcrect = {
+        (glyph % BITMAP_COLS) * font.char_w,
+        (glyph / BITMAP_ROWS) * font.char_h,
         font.char_w, font.char_h
     };
+    SDL_Rect dstrect = glyph_slotrect(slot);
+    SDL_BlitSurface(font.bitmap, &srcrect, glyphs.atlas, &dstrect);
+
+    return slot;
+}
+
+/* Whether the packed glyphs are expanded straight into the surface instead of blitted from the cache. */
+static inline bool ui_expandglyphs(void) {
+    return font.mask.rows != NULL && ui_surface->format->BytesPerPixel == 4;
+}
+
+/* Draws the cell from the front buffer. The surface must be locked for ui_expandglyphs(). */
+static void ui_rendercell(int x, int y) {
+    int i = y*ui_cols + x;
+    const ui_cell *cell = &grid.front[i];
+    bool blank = ui_color_eq(cell->fg, cell->bg);
+
+    /* The glyph only covers the margins on the edges. */
+    if (blank || x == 0 || y == 0 || x == ui_cols-1 || y == ui_rows-1) {
+        SDL_Rect area = ui_getcellrect(x, y);
+        SDL_FillRect(ui_surface, &area, SDL_MapRGB(ui_surface->format, cell->bg.r, cell->bg.g, cell->bg.b));
+    }
 
-    SDL_BlitSurface(font.bitmap, &srcrect, ui_surface, &dstrect);
+    if (!blank) {
+        SDL_Rect dstrect = {
+            ui_getmargin_w() + x * font.char_w,
+            ui_getmargin_h() + y * font.char_h,
+            font.char_w, font.char_h
+        };
+
+        if (ui_expandglyphs()) {
+            const SDL_PixelFormat *fmt = ui_surface->format;
+            Uint8 *pixels = (Uint8 *) ui_surface->pixels + dstrect.y*ui_surface->pitch + dstrect.x*4;
+            glyph_draw(&font.mask, cell->glyph,
+                       SDL_MapRGB(fmt, cell->fg.r, cell->fg.g, cell->fg.b),
+                       SDL_MapRGB(fmt, cell->bg.r, cell->bg.g, cell->bg.b),
+                       pixels, ui_surface->pitch);
+        } else {
+            /* The atlas has the format of the window surface, so this is a plain copy. */
+            SDL_Rect srcrect = glyph_slotrect(ui_getglyph(cell->glyph, cell->fg, cell->bg));
+            SDL_BlitSurface(glyphs.atlas, &srcrect, ui_surface, &dstrect);
+        }
+    }
+
+    grid.flags[i] = (grid.flags[i] & ~CELL_STALE) | CELL_DIRTY;
+}
+
+void ui_putch(int x, int y, char symbol) {
+    if (x < 0 || y < 0 || x >= ui_cols || y >= ui_rows)
+        return;
+
+    grid.back[y*ui_cols + x] = (ui_cell) { symbol, grid.fg, grid.bg };
 }
 
 void ui_putstr(int x, int y, const char *str) {
@@ -224,17 +458,118 @@ void ui_putstr(int x, int y, const char *str) {
         ui_putch(x+(ptr-str), y, *ptr);
 }
 
+const ui_cell *ui_getcells(void) {
+    return grid.back;
+}
+
+void ui_invalidate(void) {
+    for (int i = 0; i < ui_cols*ui_rows; i++)
+        grid.flags[i] |= CELL_STALE;
+}
+
 void ui_clear(void) {
-    SDL_FillRect(ui_surface, NULL, SDL_MapRGBA(
-                     ui_surface->format,
-                     font.palette[INDEX_BG].r,
-                     font.palette[INDEX_BG].g,
-                     font.palette[INDEX_BG].b,
-                     SDL_ALPHA_OPAQUE));
+    const ui_cell blank = { ' ', grid.bg, grid.bg };
+    for (int i = 0; i < ui_cols*ui_rows; i++)
+        grid.back[i] = blank;
+}
+
+void ui_blit(SDL_Surface *texture, const SDL_Rect *dstrect) {
+    if (grid.noverlays == grid.overlays_cap) {
+        int cap = grid.overlays_cap == 0 ? 4 : grid.overlays_cap * 2;
+        ui_overlay *overlays = SDL_realloc(grid.overlays, cap * sizeof(ui_overlay));
+        if (overlays == NULL) {
+            SDL_Log("Unable to allocate %d overlays", cap);
+            return;
+        }
+        grid.overlays = overlays;
+        grid.overlays_cap = cap;
+    }
+
+    grid.overlays[grid.noverlays++] = (ui_overlay) {
+        texture, { dstrect->x, dstrect->y, texture->w, texture->h }
+    };
+}
+
+/* Marks the cells under an overlay, which is blended over them and thus needs them rendered again. */
+static void ui_markoverlay(const SDL_Rect *area) {
+    int x0 = (area->x - ui_getmargin_w()) / font.char_w;
+    int y0 = (area->y - ui_getmargin_h()) / font.char_h;
+    int x1 = (area->x + area->w - 1 - ui_getmargin_w()) / font.char_w;
+    int y1 = (area->y + area->h - 1 - ui_getmargin_h()) / font.char_h;
+    x0 = max(x0, 0); y0 = max(y0, 0);
+    x1 = min(x1, ui_cols-1); y1 = min(y1, ui_rows-1);
+
+    for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++)
+            grid.flags[y*ui_cols + x] |= CELL_OVERLAY;
 }
 
 void ui_present(void) {
-    if (ui_effects.crt)
-        ui_effect_crt(ui_surface);
-    SDL_UpdateWindowSurface(ui_window);
+    post_pass passes[1];
+    int npasses = 0;
+
+    /* Changing the effects changes every pixel. */
+    if (grid.crt != ui_effects.crt || grid.crt_intensity != ui_effects.crt_intensity) {
+        grid.crt = ui_effects.crt;
+        grid.crt_intensity = ui_effects.crt_intensity;
+        ui_invalidate();
+    }
+
+    for (int i = 0; i < grid.noverlays; i++)
+        ui_markoverlay(&grid.overlays[i].area);
+
+    /* Render the cells that differ between the buffers. */
+    const bool locked = ui_expandglyphs();
+    if (locked)
+        SDL_LockSurface(ui_surface);
+
+    for (int y = 0; y < ui_rows; y++) {
+        for (int x = 0; x < ui_cols; x++) {
+            int i = y*ui_cols + x;
+            if ((grid.flags[i] & (CELL_STALE | CELL_OVERLAY)) || !ui_cell_eq(grid.front[i], grid.back[i])) {
+                grid.front[i] = grid.back[i];
+                ui_rendercell(x, y);
+            }
+        }
+    }
+
+    if (locked)
+        SDL_UnlockSurface(ui_surface);
+
+    for (int i = 0; i < grid.noverlays; i++)
+        SDL_BlitSurface(grid.overlays[i].texture, NULL, ui_surface, &grid.overlays[i].area);
+    grid.noverlays = 0;
+
+    /* The rendered cells are merged into one area per run in a row. */
+    int nrects = 0;
+    for (int y = 0; y < ui_rows; y++) {
+        for (int x = 0; x < ui_cols; x++) {
+            if (!(grid.flags[y*ui_cols + x] & CELL_DIRTY))
+                continue;
+
+            SDL_Rect area = ui_getcellrect(x, y);
+            while (x+1 < ui_cols && (grid.flags[y*ui_cols + x+1] & CELL_DIRTY))
+                x++;
+            SDL_Rect last = ui_getcellrect(x, y);
+            area.w = last.x + last.w - area.x;
+            grid.rects[nrects++] = area;
+        }
+    }
+
+    /* The cells under a texture are rendered again in the next frame, whether it is drawn or not. */
+    for (int i = 0; i < ui_cols*ui_rows; i++)
+        grid.flags[i] = (grid.flags[i] & CELL_OVERLAY) ? CELL_STALE : 0;
+
+    if (nrects == 0)
+        return;
+
+    if (ui_effects.crt) {
+        ui_effect_crt_prepare(ui_surface);
+        passes[npasses++] = (post_pass) { ui_effect_crt, NULL };
+    }
+
+    if (npasses > 0)
+        post_run(ui_surface, passes, npasses, grid.rects, nrects);
+
+    SDL_UpdateWindowSurfaceRects(ui_window, grid.rects, nrects);
 }
@@ -16,6 +16,12 @@ typedef struct {
     Uint8 r, g, b;
 } ui_color;
 
+/* Contents of a cell of the grid. A cell with the same foreground and background is blank. */
+typedef struct {
+    unsigned char glyph;
+    ui_color fg, bg;
+} ui_cell;
+
 struct ui_effects {
     bool crt;
     double crt_intensity;
@@ -37,7 +43,18 @@ void ui_setfg(ui_color);
 void ui_putch(int x, int y, char c);
 void ui_putstr(int x, int y, const char *str);
 
+/* The frame is composed in a grid of ui_cols*ui_rows cells, cleared by ui_clear().
+ * ui_present() renders and updates only the cells that changed since the previous frame. */
 void ui_clear(void);
 void ui_present(void);
 
+/* The cells of the frame being composed, row by row. */
+const ui_cell *ui_getcells(void);
+
+/* Draws a texture over the cells in this frame. It is blended by ui_present(), so it must stay valid until then. */
+void ui_blit(SDL_Surface *texture, const SDL_Rect *dstrect);
+
+/* Makes the next ui_present() render the whole window again, e.g. after it was exposed. */
+void ui_invalidate(void);
+
 #endif